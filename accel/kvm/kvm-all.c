@@ -842,7 +842,12 @@ static void kvm_dirty_ring_mark_page(KVMState *s, uint32_t as_id,
         return;
     }
 
-    set_bit(offset, mem->dirty_bmap);
+    /* Parallel reap workers may share a slot's bitmap */
+    if (s->reaper.nr_workers) {
+        set_bit_atomic(offset, mem->dirty_bmap);
+    } else {
+        set_bit(offset, mem->dirty_bmap);
+    }
 }
 
 static bool dirty_gfn_is_dirtied(struct kvm_dirty_gfn *gfn)
@@ -915,6 +920,73 @@ static uint32_t kvm_dirty_ring_reap_one(KVMState *s, CPUState *cpu)
     return count;
 }
 
+/*
+ * Reap the dirty rings of all vCPUs in @slice.  The slots_lock is held by the
+ * thread that initiated the reap, which waits for all slices to finish.
+ */
+static uint64_t kvm_dirty_ring_reap_slice(KVMState *s, unsigned int slice)
+{
+    struct KVMDirtyRingReaper *r = &s->reaper;
+    uint64_t total = 0;
+    CPUState *cpu;
+
+    WITH_RCU_READ_LOCK_GUARD() {
+        CPU_FOREACH(cpu) {
+            if (MIN(cpu->cpu_index / r->vcpus_per_slice, r->nr_workers) ==
+                slice) {
+                total += kvm_dirty_ring_reap_one(s, cpu);
+            }
+        }
+    }
+
+    return total;
+}
+
+static void *kvm_dirty_ring_reap_worker_thread(void *opaque)
+{
+    KVMDirtyRingReapWorker *w = opaque;
+    KVMState *s = w->s;
+
+    rcu_register_thread();
+
+    while (true) {
+        qemu_sem_wait(&w->sem);
+        w->total = kvm_dirty_ring_reap_slice(s, w->slice);
+        qemu_sem_post(&s->reaper.sem_done);
+    }
+
+    g_assert_not_reached();
+}
+
+/* Reap all vCPU rings, using the worker threads if there are any */
+static uint64_t kvm_dirty_ring_reap_all(KVMState *s)
+{
+    struct KVMDirtyRingReaper *r = &s->reaper;
+    uint64_t total = 0;
+    CPUState *cpu;
+    unsigned int i;
+
+    if (!r->nr_workers) {
+        CPU_FOREACH(cpu) {
+            total += kvm_dirty_ring_reap_one(s, cpu);
+        }
+        return total;
+    }
+
+    for (i = 0; i < r->nr_workers; i++) {
+        qemu_sem_post(&r->workers[i].sem);
+    }
+    total = kvm_dirty_ring_reap_slice(s, 0);
+    for (i = 0; i < r->nr_workers; i++) {
+        qemu_sem_wait(&r->sem_done);
+    }
+    for (i = 0; i < r->nr_workers; i++) {
+        total += r->workers[i].total;
+    }
+
+    return total;
+}
+
 /* Must be with slots_lock held */
 static uint64_t kvm_dirty_ring_reap_locked(KVMState *s, CPUState* cpu)
 {
@@ -927,9 +999,7 @@ static uint64_t kvm_dirty_ring_reap_locked(KVMState *s, CPUState* cpu)
     if (cpu) {
         total = kvm_dirty_ring_reap_one(s, cpu);
     } else {
-        CPU_FOREACH(cpu) {
-            total += kvm_dirty_ring_reap_one(s, cpu);
-        }
+        total = kvm_dirty_ring_reap_all(s);
     }
 
     if (total) {
@@ -941,6 +1011,8 @@ static uint64_t kvm_dirty_ring_reap_locked(KVMState *s, CPUState* cpu)
 
     if (total) {
         trace_kvm_dirty_ring_reap(total, stamp / 1000);
+        qatomic_inc(&s->reaper.reap_count);
+        qatomic_add(&s->reaper.reap_time_ns, stamp);
     }
 
     return total;
@@ -1068,8 +1140,31 @@ static int kvm_log_clear_one_slot(KVMSlot *mem, int as_id, uint64_t start,
     uint64_t end, bmap_start, start_delta, bmap_npages;
     struct kvm_clear_dirty_log d;
     unsigned long *bmap_clear = NULL, psize = qemu_real_host_page_size();
+    unsigned long first_dirty, last_dirty;
     int ret;
 
+    /* We should never do log_clear before log_sync */
+    assert(mem->dirty_bmap);
+
+    /*
+     * Only pages that are dirty in the cached bitmap need to be
+     * re-protected.  Migration clears each chunk lazily right before
+     * sending it, and most chunks are clean or only sparsely dirty, so
+     * skip the ioctl for clean ranges and trim the range to the dirty
+     * pages it contains.  This keeps the cost of a clear proportional to
+     * what the guest actually dirtied.
+     */
+    first_dirty = find_next_bit(mem->dirty_bmap, (start + size) / psize,
+                                start / psize);
+    if (first_dirty >= (start + size) / psize) {
+        trace_kvm_clear_dirty_log_skip(mem->slot | (as_id << 16),
+                                       start / psize, size / psize);
+        return 0;
+    }
+    last_dirty = find_last_bit(mem->dirty_bmap, (start + size) / psize);
+    start = first_dirty * psize;
+    size = (last_dirty + 1 - first_dirty) * psize;
+
     /*
      * We need to extend either the start or the size or both to
      * satisfy the KVM interface requirement.  Firstly, do the start
@@ -1116,8 +1211,6 @@ static int kvm_log_clear_one_slot(KVMSlot *mem, int as_id, uint64_t start,
      */
 
     assert(bmap_start % BITS_PER_LONG == 0);
-    /* We should never do log_clear before log_sync */
-    assert(mem->dirty_bmap);
     if (start_delta || bmap_npages - size / psize) {
         /* Slow path - we need to manipulate a temp bitmap */
         bmap_clear = bitmap_new(bmap_npages);
@@ -1661,9 +1754,28 @@ static void *kvm_dirty_ring_reaper_thread(void *data)
     g_assert_not_reached();
 }
 
-static void kvm_dirty_ring_reaper_init(KVMState *s)
+static void kvm_dirty_ring_reaper_init(KVMState *s, unsigned int max_cpus)
 {
     struct KVMDirtyRingReaper *r = &s->reaper;
+    unsigned int i;
+
+    if (r->vcpus_per_slice &&
+        DIV_ROUND_UP(max_cpus, r->vcpus_per_slice) > 1) {
+        r->nr_workers = DIV_ROUND_UP(max_cpus, r->vcpus_per_slice) - 1;
+        r->workers = g_new0(KVMDirtyRingReapWorker, r->nr_workers);
+        qemu_sem_init(&r->sem_done, 0);
+
+        for (i = 0; i < r->nr_workers; i++) {
+            KVMDirtyRingReapWorker *w = &r->workers[i];
+
+            w->s = s;
+            w->slice = i + 1;
+            qemu_sem_init(&w->sem, 0);
+            qemu_thread_create(&w->thread, "kvm-reap-worker",
+                               kvm_dirty_ring_reap_worker_thread,
+                               w, QEMU_THREAD_DETACHED);
+        }
+    }
 
     qemu_thread_create(&r->reaper_thr, "kvm-reaper",
                        kvm_dirty_ring_reaper_thread,
@@ -2498,6 +2610,16 @@ bool kvm_dirty_ring_enabled(void)
     return kvm_state && kvm_state->kvm_dirty_ring_size;
 }
 
+void kvm_dirty_ring_get_stats(uint64_t *ring_full_exits,
+                              uint64_t *reap_count, uint64_t *reap_time_ns)
+{
+    struct KVMDirtyRingReaper *r = &kvm_state->reaper;
+
+    *ring_full_exits = qatomic_read(&r->ring_full_exits);
+    *reap_count = qatomic_read(&r->reap_count);
+    *reap_time_ns = qatomic_read(&r->reap_time_ns);
+}
+
 static void query_stats_cb(StatsResultList **result, StatsTarget target,
                            strList *names, strList *targets, Error **errp);
 static void query_stats_schemas_cb(StatsSchemaList **result, Error **errp);
@@ -2812,7 +2934,7 @@ static int kvm_init(AccelState *as, MachineState *ms)
     }
 
     if (s->kvm_dirty_ring_size) {
-        kvm_dirty_ring_reaper_init(s);
+        kvm_dirty_ring_reaper_init(s, ms->smp.max_cpus);
     }
 
     if (kvm_check_extension(kvm_state, KVM_CAP_BINARY_STATS_FD)) {
@@ -3273,6 +3395,7 @@ int kvm_cpu_exec(CPUState *cpu)
              * still full.  Got kicked by KVM_RESET_DIRTY_RINGS.
              */
             trace_kvm_dirty_ring_full(cpu->cpu_index);
+            qatomic_inc(&kvm_state->reaper.ring_full_exits);
             bql_lock();
             /*
              * We throttle vCPU by making it sleep once it exit from kernel
@@ -3943,6 +4066,35 @@ static void kvm_set_dirty_ring_size(Object *obj, Visitor *v,
     s->kvm_dirty_ring_size = value;
 }
 
+static void kvm_get_dirty_ring_vcpus_per_reaper(Object *obj, Visitor *v,
+                                                const char *name, void *opaque,
+                                                Error **errp)
+{
+    KVMState *s = KVM_STATE(obj);
+    uint32_t value = s->reaper.vcpus_per_slice;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void kvm_set_dirty_ring_vcpus_per_reaper(Object *obj, Visitor *v,
+                                                const char *name, void *opaque,
+                                                Error **errp)
+{
+    KVMState *s = KVM_STATE(obj);
+    uint32_t value;
+
+    if (s->fd != -1) {
+        error_setg(errp, "Cannot set properties after the accelerator has been initialized");
+        return;
+    }
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+
+    s->reaper.vcpus_per_slice = value;
+}
+
 static char *kvm_get_device(Object *obj,
                             Error **errp G_GNUC_UNUSED)
 {
@@ -4036,6 +4188,14 @@ static void kvm_accel_class_init(ObjectClass *oc, const void *data)
     object_class_property_set_description(oc, "dirty-ring-size",
         "Size of KVM dirty page ring buffer (default: 0, i.e. use bitmap)");
 
+    object_class_property_add(oc, "dirty-ring-vcpus-per-reaper", "uint32",
+        kvm_get_dirty_ring_vcpus_per_reaper,
+        kvm_set_dirty_ring_vcpus_per_reaper,
+        NULL, NULL);
+    object_class_property_set_description(oc, "dirty-ring-vcpus-per-reaper",
+        "Number of vCPU dirty rings harvested by each parallel reaper thread "
+        "(default: 0, i.e. reap all rings in one thread)");
+
     object_class_property_add_str(oc, "device", kvm_get_device, kvm_set_device);
     object_class_property_set_description(oc, "device",
         "Path to the device node to use (default: /dev/kvm)");
@@ -116,6 +116,12 @@ uint32_t kvm_dirty_ring_size(void)
     return 0;
 }
 
+void kvm_dirty_ring_get_stats(uint64_t *ring_full_exits,
+                              uint64_t *reap_count, uint64_t *reap_time_ns)
+{
+    g_assert_not_reached();
+}
+
 bool kvm_hwpoisoned_mem(void)
 {
     return false;
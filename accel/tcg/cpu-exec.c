@@ -969,7 +969,22 @@ cpu_exec_loop(CPUState *cpu, SyncClocks *sc)
                 uint32_t h;
 
                 mmap_lock();
+#ifdef CONFIG_USER_ONLY
+                /*
+                 * Translation is serialized by mmap_lock.  When several
+                 * threads miss on the same block at once, which is typical
+                 * for threads running the same code, all but the first
+                 * find it in the hash table once they get the lock; don't
+                 * make them translate it again only for tb_link_page() to
+                 * throw the copy away.
+                 */
+                tb = tb_htable_lookup(cpu, s);
+                if (tb == NULL) {
+                    tb = tb_gen_code(cpu, s);
+                }
+#else
                 tb = tb_gen_code(cpu, s);
+#endif
                 mmap_unlock();
 
                 /*
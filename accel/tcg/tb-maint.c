@@ -66,7 +66,7 @@ static bool tb_cmp(const void *ap, const void *bp)
 
 void tb_htable_init(void)
 {
-    unsigned int mode = QHT_MODE_AUTO_RESIZE;
+    unsigned int mode = QHT_MODE_AUTO_RESIZE | QHT_MODE_INTERLEAVE;
 
     qht_init(&tb_ctx.htable, tb_cmp, CODE_GEN_HTABLE_SIZE, mode);
 }
@@ -22,7 +22,13 @@
 #include "qemu/mmap-alloc.h"
 #include "qemu/madvise.h"
 #include "qemu/cutils.h"
+#include "qemu/error-report.h"
+#include "qemu/main-loop.h"
+#include "qemu/thread-context.h"
+#include "qemu/timer.h"
 #include "hw/core/qdev.h"
+#include "system/runstate.h"
+#include "trace.h"
 
 #ifdef CONFIG_NUMA
 #include <numaif.h>
@@ -245,18 +251,55 @@ static void host_memory_backend_set_prealloc(Object *obj, bool value,
     }
 
     if (value && !backend->prealloc) {
-        int fd = memory_region_get_fd(&backend->mr);
         void *ptr = memory_region_get_ram_ptr(&backend->mr);
         uint64_t sz = memory_region_size(&backend->mr);
 
-        if (!qemu_prealloc_mem(fd, ptr, sz, backend->prealloc_threads,
-                               backend->prealloc_context, false, errp)) {
+        if (!host_memory_backend_prealloc(backend, ptr, sz, false, errp)) {
             return;
         }
         backend->prealloc = true;
     }
 }
 
+static bool host_memory_backend_get_prealloc_node_affinity(Object *obj,
+                                                           Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    return backend->prealloc_node_affinity;
+}
+
+static void host_memory_backend_set_prealloc_node_affinity(Object *obj,
+                                                           bool value,
+                                                           Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    backend->prealloc_node_affinity = value;
+}
+
+static bool host_memory_backend_get_prealloc_background(Object *obj,
+                                                       Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    return backend->prealloc_background;
+}
+
+static void host_memory_backend_set_prealloc_background(Object *obj,
+                                                       bool value,
+                                                       Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    if (host_memory_backend_mr_inited(backend)) {
+        error_setg(errp, "cannot change property 'prealloc-background' of %s",
+                   object_get_typename(obj));
+        return;
+    }
+    backend->prealloc_background = value;
+}
+
 static void host_memory_backend_get_prealloc_threads(Object *obj, Visitor *v,
     const char *name, void *opaque, Error **errp)
 {
@@ -330,6 +373,174 @@ size_t host_memory_backend_pagesize(HostMemoryBackend *memdev)
     return pagesize;
 }
 
+#ifdef CONFIG_NUMA
+/*
+ * Creates a thread context whose threads run on the CPUs of @nodes, a list of
+ * host NUMA nodes in the format of the node-affinity property.  Returns NULL
+ * if that is not possible, for example for memory-only nodes.
+ */
+static ThreadContext *
+host_memory_backend_create_node_context(HostMemoryBackend *backend,
+                                        const char *nodes, unsigned int idx)
+{
+    g_autofree char *name = g_strdup_printf("prealloc-context-%u", idx);
+    Object *obj = object_new(TYPE_THREAD_CONTEXT);
+
+    object_property_add_child(OBJECT(backend), name, obj);
+    object_unref(obj);
+
+    if (!object_property_parse(obj, "node-affinity", nodes, NULL) ||
+        !user_creatable_complete(USER_CREATABLE(obj), NULL)) {
+        object_unparent(obj);
+        return NULL;
+    }
+    return THREAD_CONTEXT(obj);
+}
+
+/*
+ * Preallocate with threads placed on the host NUMA nodes the memory is
+ * bound to, so that pages get allocated and zeroed by CPUs local to the
+ * memory.  With policy bind or preferred, the area is split into one chunk
+ * per node and each chunk is preallocated by threads running on that node.
+ * With policy interleave, where the placement doesn't depend on the faulting
+ * CPU, all threads run on the CPUs of all nodes.
+ *
+ * If @async is set, the chunks are queued for asynchronous preallocation and
+ * populated concurrently once qemu_finish_async_prealloc_mem() is called.
+ * Otherwise they are populated one after the other, each with all of the
+ * backend's preallocation threads, so that only this backend's memory is
+ * waited for.
+ */
+static bool host_memory_backend_prealloc_nodes(HostMemoryBackend *backend,
+                                               void *ptr, uint64_t sz,
+                                               bool async, Error **errp)
+{
+    int fd = memory_region_get_fd(&backend->mr);
+    size_t pagesize = qemu_ram_pagesize(backend->mr.ram_block);
+    unsigned long nr_nodes = bitmap_count_one(backend->host_nodes, MAX_NODES);
+    unsigned long node = find_first_bit(backend->host_nodes, MAX_NODES);
+    unsigned int nr_chunks, threads, i;
+    uint64_t chunk_size, offset = 0;
+    int64_t start = get_clock();
+    bool ret = true;
+
+    if (backend->policy == HOST_MEM_POLICY_INTERLEAVE) {
+        nr_chunks = 1;
+    } else {
+        nr_chunks = MAX(1, MIN(nr_nodes, sz / pagesize));
+    }
+    chunk_size = ROUND_UP(DIV_ROUND_UP(sz, nr_chunks), pagesize);
+    threads = backend->prealloc_threads;
+    if (async) {
+        threads = MAX(1, threads / nr_chunks);
+    }
+
+    for (i = 0; i < nr_chunks && offset < sz; i++) {
+        g_autofree char *nodes = NULL;
+        uint64_t size = MIN(chunk_size, sz - offset);
+        ThreadContext *tc;
+
+        if (nr_chunks == 1) {
+            GString *str = g_string_new(NULL);
+
+            for (; node < MAX_NODES;
+                 node = find_next_bit(backend->host_nodes, MAX_NODES,
+                                      node + 1)) {
+                g_string_append_printf(str, "%s%lu", str->len ? "," : "",
+                                       node);
+            }
+            nodes = g_string_free(str, false);
+        } else {
+            nodes = g_strdup_printf("%lu", node);
+            node = find_next_bit(backend->host_nodes, MAX_NODES, node + 1);
+        }
+
+        tc = host_memory_backend_create_node_context(backend, nodes, i);
+        trace_host_memory_backend_prealloc_chunk(backend, nodes,
+                                                 (char *)ptr + offset, size,
+                                                 threads, tc != NULL);
+        ret = qemu_prealloc_mem(fd, (char *)ptr + offset, size, threads, tc,
+                                async, errp);
+        if (tc) {
+            object_unparent(OBJECT(tc));
+        }
+        if (!ret) {
+            break;
+        }
+        offset += size;
+    }
+
+    if (ret && !async) {
+        trace_host_memory_backend_prealloc_done(backend, sz,
+                                                (get_clock() - start) /
+                                                SCALE_MS);
+    }
+    return ret;
+}
+#endif
+
+/*
+ * Preallocate the area of @sz bytes at @ptr of the backend's memory.  If
+ * @async is set, preallocation may continue in the background until
+ * qemu_finish_async_prealloc_mem() is called.
+ */
+bool host_memory_backend_prealloc(HostMemoryBackend *backend, void *ptr,
+                                  uint64_t sz, bool async, Error **errp)
+{
+    int fd = memory_region_get_fd(&backend->mr);
+    int64_t start = get_clock();
+    bool ret;
+
+#ifdef CONFIG_NUMA
+    if (backend->prealloc_node_affinity && !backend->prealloc_context &&
+        backend->policy != HOST_MEM_POLICY_DEFAULT &&
+        !bitmap_empty(backend->host_nodes, MAX_NODES)) {
+        return host_memory_backend_prealloc_nodes(backend, ptr, sz, async,
+                                                  errp);
+    }
+#endif
+
+    ret = qemu_prealloc_mem(fd, ptr, sz, backend->prealloc_threads,
+                            backend->prealloc_context, async, errp);
+    if (ret && !async) {
+        trace_host_memory_backend_prealloc_done(backend, sz,
+                                                (get_clock() - start) /
+                                                SCALE_MS);
+    }
+    return ret;
+}
+
+/* Runs in the main loop once background preallocation has finished */
+static void host_memory_backend_prealloc_background_bh(void *opaque)
+{
+    HostMemoryBackend *backend = opaque;
+    int ret = qatomic_read(&backend->prealloc_background_ret);
+
+    qemu_prealloc_mem_background_free(backend->prealloc_bg);
+    backend->prealloc_bg = NULL;
+    ram_block_discard_disable(false);
+
+    if (ret) {
+        g_autofree char *name = host_memory_backend_get_name(backend);
+
+        error_report("memory backend '%s': background preallocation failed: "
+                     "%s", name, strerror(-ret));
+    }
+    object_unref(OBJECT(backend));
+}
+
+/* Runs in a preallocation thread */
+static void host_memory_backend_prealloc_background_done(void *opaque,
+                                                         int ret)
+{
+    HostMemoryBackend *backend = opaque;
+
+    qatomic_set(&backend->prealloc_background_ret, ret);
+    aio_bh_schedule_oneshot(qemu_get_aio_context(),
+                            host_memory_backend_prealloc_background_bh,
+                            backend);
+}
+
 static void
 host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
 {
@@ -343,6 +554,23 @@ host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
     if (!bc->alloc) {
         return;
     }
+    if (backend->prealloc && backend->prealloc_background) {
+        /*
+         * Incoming migration places or discards pages itself (postcopy
+         * even relies on them being missing), which populating them in
+         * the background would race with.
+         */
+        if (runstate_check(RUN_STATE_INMIGRATE)) {
+            error_setg(errp, "'prealloc-background' cannot be used with "
+                       "incoming migration");
+            return;
+        }
+        if (backend->prealloc_node_affinity) {
+            error_setg(errp, "'prealloc-background' cannot be combined with "
+                       "'prealloc-node-affinity'");
+            return;
+        }
+    }
     if (!bc->alloc(backend, errp)) {
         return;
     }
@@ -423,11 +651,32 @@ host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
      * This is necessary to guarantee memory is allocated with
      * specified NUMA policy in place.
      */
-    if (backend->prealloc && !qemu_prealloc_mem(memory_region_get_fd(&backend->mr),
-                                                ptr, sz,
-                                                backend->prealloc_threads,
-                                                backend->prealloc_context,
-                                                async, errp)) {
+    if (backend->prealloc && backend->prealloc_background) {
+        /*
+         * Let the VM start right away.  Guest accesses to pages that are not
+         * populated yet simply fault them in.
+         *
+         * Discarded RAM (balloon, virtio-mem) would be faulted back in by
+         * the preallocation threads, so disable discards until they are
+         * done.
+         */
+        if (ram_block_discard_disable(true)) {
+            error_setg(errp, "'prealloc-background' cannot be used while a "
+                       "device requires discarding RAM");
+            return;
+        }
+        object_ref(OBJECT(backend));
+        backend->prealloc_bg = qemu_prealloc_mem_background(
+            memory_region_get_fd(&backend->mr), ptr, sz,
+            backend->prealloc_threads, backend->prealloc_context,
+            host_memory_backend_prealloc_background_done, backend, errp);
+        if (!backend->prealloc_bg) {
+            object_unref(OBJECT(backend));
+            ram_block_discard_disable(false);
+            return;
+        }
+    } else if (backend->prealloc &&
+               !host_memory_backend_prealloc(backend, ptr, sz, async, errp)) {
         return;
     }
 }
@@ -435,7 +684,9 @@ host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
 static bool
 host_memory_backend_can_be_deleted(UserCreatable *uc)
 {
-    if (host_memory_backend_is_mapped(MEMORY_BACKEND(uc))) {
+    HostMemoryBackend *backend = MEMORY_BACKEND(uc);
+
+    if (host_memory_backend_is_mapped(backend) || backend->prealloc_bg) {
         return false;
     } else {
         return true;
@@ -535,6 +786,16 @@ host_memory_backend_class_init(ObjectClass *oc, const void *data)
         object_property_allow_set_link, OBJ_PROP_LINK_STRONG);
     object_class_property_set_description(oc, "prealloc-context",
         "Context to use for creating CPU threads for preallocation");
+    object_class_property_add_bool(oc, "prealloc-background",
+        host_memory_backend_get_prealloc_background,
+        host_memory_backend_set_prealloc_background);
+    object_class_property_set_description(oc, "prealloc-background",
+        "Preallocate memory in the background without delaying VM start");
+    object_class_property_add_bool(oc, "prealloc-node-affinity",
+        host_memory_backend_get_prealloc_node_affinity,
+        host_memory_backend_set_prealloc_node_affinity);
+    object_class_property_set_description(oc, "prealloc-node-affinity",
+        "Run preallocation threads on the CPUs of the bound host nodes");
     object_class_property_add(oc, "size", "int",
         host_memory_backend_get_size,
         host_memory_backend_set_size,
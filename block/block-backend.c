@@ -83,6 +83,12 @@ struct BlockBackend {
     CoQueue queued_requests;
     bool disable_request_queuing; /* atomic */
 
+    /*
+     * Set if the driver of the root node implements .bdrv_aio_preadv_fast,
+     * see blk_aio_read_fast().  Written under BQL, read atomically.
+     */
+    bool aio_read_fast;
+
     VMChangeStateEntry *vmsh;
     bool force_allow_inactivate;
 
@@ -287,6 +293,9 @@ static void blk_root_attach(BdrvChild *child)
 
     trace_blk_root_attach(child, blk, child->bs);
 
+    qatomic_set(&blk->aio_read_fast,
+                child->bs->drv && child->bs->drv->bdrv_aio_preadv_fast);
+
     QLIST_FOREACH(notifier, &blk->aio_notifiers, list) {
         bdrv_add_aio_context_notifier(child->bs,
                 notifier->attached_aio_context,
@@ -302,6 +311,8 @@ static void blk_root_detach(BdrvChild *child)
 
     trace_blk_root_detach(child, blk, child->bs);
 
+    qatomic_set(&blk->aio_read_fast, false);
+
     QLIST_FOREACH(notifier, &blk->aio_notifiers, list) {
         bdrv_remove_aio_context_notifier(child->bs,
                 notifier->attached_aio_context,
@@ -1576,6 +1587,60 @@ static void blk_aio_complete_bh(void *opaque)
     blk_aio_complete(acb);
 }
 
+/* Runs outside of the caller's lock scope, hence TSA_NO_TSA */
+static void TSA_NO_TSA blk_aio_read_fast_cb(void *opaque, int ret)
+{
+    BlkAioEmAIOCB *acb = opaque;
+
+    bdrv_graph_rdunlock_nocoroutine();
+    acb->rwco.ret = ret;
+    blk_aio_complete(acb);
+}
+
+/*
+ * Plain reads from a root node whose driver can start them outside of
+ * coroutine context don't need a coroutine; see bdrv_aio_preadv_fast().
+ * Anything that blk_co_do_preadv_part() might have to wait for (drain,
+ * throttling) or that has to be replayed takes the coroutine path instead.
+ * The graph lock is held until the request completes, as in the coroutine
+ * path.
+ */
+static bool blk_aio_read_fast(BlkAioEmAIOCB *acb)
+{
+    BlockBackend *blk = acb->rwco.blk;
+    BdrvChild *root;
+
+    if (!qatomic_read(&blk->aio_read_fast)) {
+        return false;
+    }
+
+    if (acb->rwco.flags || replay_mode != REPLAY_MODE_NONE ||
+        qatomic_read(&blk->quiesce_counter) ||
+        blk->public.throttle_group_member.throttle_state ||
+        blk_dev_is_tray_open(blk)) {
+        return false;
+    }
+
+    if (!bdrv_graph_rdlock_try()) {
+        return false;
+    }
+    assume_graph_lock(); /* taken by bdrv_graph_rdlock_try() */
+
+    root = blk->root;
+    if (root) {
+        trace_blk_co_preadv(blk, root->bs, acb->rwco.offset, acb->bytes, 0);
+        if (bdrv_aio_preadv_fast(root, acb->rwco.offset, acb->bytes,
+                                 acb->rwco.iobuf, blk_aio_read_fast_cb, acb)) {
+            return true;
+        }
+    }
+
+    bdrv_graph_rdunlock_nocoroutine();
+    return false;
+}
+
+static void coroutine_fn blk_aio_read_entry(void *opaque);
+
 static BlockAIOCB *blk_aio_prwv(BlockBackend *blk, int64_t offset,
                                 int64_t bytes,
                                 void *iobuf, CoroutineEntry co_entry,
@@ -1597,8 +1662,10 @@ static BlockAIOCB *blk_aio_prwv(BlockBackend *blk, int64_t offset,
     acb->bytes = bytes;
     acb->has_returned = false;
 
-    co = qemu_coroutine_create(co_entry, acb);
-    aio_co_enter(qemu_get_current_aio_context(), co);
+    if (co_entry != blk_aio_read_entry || !blk_aio_read_fast(acb)) {
+        co = qemu_coroutine_create(co_entry, acb);
+        aio_co_enter(qemu_get_current_aio_context(), co);
+    }
 
     acb->has_returned = true;
     if (acb->rwco.ret != NOT_DONE) {
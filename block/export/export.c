@@ -81,6 +81,8 @@ BlockExport *blk_exp_add(BlockExportOptions *export, Error **errp)
     BlockDriverState *bs;
     BlockBackend *blk = NULL;
     AioContext *ctx;
+    AioContext **multithread_ctxs = NULL;
+    size_t multithread_count = 0;
     uint64_t perm;
     int ret;
 
@@ -120,10 +122,45 @@ BlockExport *blk_exp_add(BlockExportOptions *export, Error **errp)
         IOThread *iothread;
         AioContext *new_ctx;
         Error **set_context_errp;
+        const char *iothread_id;
+
+        if (export->iothread->type == QTYPE_QLIST) {
+            strList *item;
+            size_t i = 0;
+
+            if (!drv->supports_multithread) {
+                error_setg(errp, "This export type does not support "
+                           "multi-threading");
+                goto fail;
+            }
+
+            for (item = export->iothread->u.multi; item; item = item->next) {
+                multithread_count++;
+            }
+            if (multithread_count == 0) {
+                error_setg(errp, "The set of I/O threads must not be empty");
+                goto fail;
+            }
+
+            multithread_ctxs = g_new(AioContext *, multithread_count);
+            for (item = export->iothread->u.multi; item; item = item->next) {
+                iothread = iothread_by_id(item->value);
+                if (!iothread) {
+                    error_setg(errp, "iothread \"%s\" not found", item->value);
+                    goto fail;
+                }
+                multithread_ctxs[i++] = iothread_get_aio_context(iothread);
+            }
+
+            /* The block node itself lives in the first iothread */
+            iothread_id = export->iothread->u.multi->value;
+        } else {
+            iothread_id = export->iothread->u.single;
+        }
 
-        iothread = iothread_by_id(export->iothread);
+        iothread = iothread_by_id(iothread_id);
         if (!iothread) {
-            error_setg(errp, "iothread \"%s\" not found", export->iothread);
+            error_setg(errp, "iothread \"%s\" not found", iothread_id);
             goto fail;
         }
 
@@ -193,6 +230,8 @@ BlockExport *blk_exp_add(BlockExportOptions *export, Error **errp)
         .id         = g_strdup(export->id),
         .ctx        = ctx,
         .blk        = blk,
+        .multithread_ctxs = multithread_ctxs,
+        .multithread_count = multithread_count,
     };
 
     ret = drv->create(exp, export, errp);
@@ -214,6 +253,7 @@ fail:
         g_free(exp->id);
         g_free(exp);
     }
+    g_free(multithread_ctxs);
     return NULL;
 }
 
@@ -234,6 +274,7 @@ static void blk_exp_delete_bh(void *opaque)
     blk_set_dev_ops(exp->blk, NULL, NULL);
     blk_unref(exp->blk);
     qapi_event_send_block_export_deleted(exp->id);
+    g_free(exp->multithread_ctxs);
     g_free(exp->id);
     g_free(exp);
 }
@@ -21,6 +21,8 @@
 #include "qemu/osdep.h"
 #include "qemu/memalign.h"
 #include "qemu/aio.h"
+#include "qemu/coroutine.h"
+#include "block/aio-wait.h"
 #include "block/block_int-common.h"
 #include "block/export.h"
 #include "block/fuse.h"
@@ -30,41 +32,102 @@
 #include "qemu/main-loop.h"
 #include "system/block-backend.h"
 
-#include <fuse.h>
 #include <fuse_lowlevel.h>
 
+#include "standard-headers/linux/fuse.h"
+
 #if defined(CONFIG_FALLOCATE_ZERO_RANGE)
 #include <linux/falloc.h>
 #endif
 
 #ifdef __linux__
 #include <linux/fs.h>
+#include <sys/ioctl.h>
 #endif
 
 /* Prevent overly long bounce buffer allocations */
 #define FUSE_MAX_BOUNCE_BYTES (MIN(BDRV_REQUEST_MAX_BYTES, 64 * 1024 * 1024))
 
+/*
+ * Largest write the kernel may send.  Every queue has a request buffer that
+ * must be able to hold such a write, so do not make this too large.
+ */
+#define FUSE_MAX_WRITE_BYTES (1 * 1024 * 1024)
+
+#define FUSE_REQUEST_BUF_SIZE \
+    MAX(FUSE_MIN_READ_BUFFER, \
+        sizeof(struct fuse_in_header) + sizeof(struct fuse_write_in) + \
+        FUSE_MAX_WRITE_BYTES)
+
+/*
+ * Oldest kernel protocol version we accept (Linux 3.15).  All request and
+ * reply structures we use have their current layout since then.
+ */
+#define FUSE_MIN_KERNEL_MINOR 23
+
+/* Number of background requests (e.g. readahead) the kernel may queue */
+#define FUSE_MAX_BACKGROUND 64
+
+/* FUSE_INIT flags we enable if the kernel offers them */
+#define FUSE_INIT_FLAGS (FUSE_ASYNC_READ | FUSE_ATOMIC_O_TRUNC | \
+                         FUSE_BIG_WRITES | FUSE_AUTO_INVAL_DATA | \
+                         FUSE_ASYNC_DIO | FUSE_MAX_PAGES)
+
+/*
+ * A channel to the kernel.  Queue 0 uses the FUSE session fd, all others use
+ * clones of it (FUSE_DEV_IOC_CLONE).  The kernel hands every request to one
+ * of the channels, and the reply must be written to that same channel.
+ */
+typedef struct FuseQueue {
+    struct FuseExport *exp;
+    AioContext *ctx;
+    int fuse_fd;
+
+    /*
+     * Requests are read into this buffer.  Request coroutines copy out all
+     * they need before they first yield, so the buffer can be reused for the
+     * next request right away.
+     */
+    void *request_buf;
+    size_t request_len;
+} FuseQueue;
 
 typedef struct FuseExport {
     BlockExport common;
 
     struct fuse_session *fuse_session;
-    struct fuse_buf fuse_buf;
     unsigned int in_flight; /* atomic */
     bool mounted, fd_handler_set_up;
 
+    /* One queue per AioContext the export runs in */
+    FuseQueue *queues;
+    size_t num_queues;
+
     char *mountpoint;
     bool writable;
     bool growable;
     /* Whether allow_other was used as a mount option or not */
     bool allow_other;
 
+    /*
+     * Requests run concurrently in several AioContexts, so these are
+     * accessed with atomics after the export has been set up
+     */
     mode_t st_mode;
     uid_t st_uid;
     gid_t st_gid;
+
+    /* Serializes changes of the image length */
+    CoMutex resize_lock;
 } FuseExport;
 
 static GHashTable *exports;
+
+/*
+ * libfuse is only used to create and mount the session.  Requests are read
+ * from the FUSE fds and processed by QEMU itself (see read_from_fuse_queue()),
+ * so that they can be spread across multiple queues and run in coroutines.
+ */
 static const struct fuse_lowlevel_ops fuse_ops;
 
 static void fuse_export_shutdown(BlockExport *exp);
@@ -74,19 +137,60 @@ static void init_exports_table(void);
 
 static int setup_fuse_export(FuseExport *exp, const char *mountpoint,
                              bool allow_other, Error **errp);
-static void read_from_fuse_export(void *opaque);
+static int setup_fuse_queues(FuseExport *exp, Error **errp);
+static void read_from_fuse_queue(void *opaque);
 
 static bool is_regular_file(const char *path, Error **errp);
 
 
+/**
+ * Start reading requests from all queues.
+ */
+static void fuse_export_attach_queues(FuseExport *exp)
+{
+    for (size_t i = 0; i < exp->num_queues; i++) {
+        FuseQueue *q = &exp->queues[i];
+
+        aio_set_fd_handler(q->ctx, q->fuse_fd, read_from_fuse_queue,
+                           NULL, NULL, NULL, q);
+    }
+    exp->fd_handler_set_up = true;
+}
+
+static void fuse_queue_detach_bh(void *opaque)
+{
+    FuseQueue *q = opaque;
+
+    aio_set_fd_handler(q->ctx, q->fuse_fd, NULL, NULL, NULL, NULL, NULL);
+}
+
+/**
+ * Stop reading requests from all queues.
+ *
+ * The fd handlers are removed in the AioContext of their queue, and we wait
+ * for that to happen.  Afterwards, read_from_fuse_queue() cannot be running
+ * in any queue, so every request that it started has been counted in
+ * exp->in_flight and fuse_export_drained_poll() sees it.
+ */
+static void fuse_export_detach_queues(FuseExport *exp)
+{
+    for (size_t i = 0; i < exp->num_queues; i++) {
+        FuseQueue *q = &exp->queues[i];
+
+        if (q->ctx == qemu_get_current_aio_context()) {
+            fuse_queue_detach_bh(q);
+        } else {
+            aio_wait_bh_oneshot(q->ctx, fuse_queue_detach_bh, q);
+        }
+    }
+    exp->fd_handler_set_up = false;
+}
+
 static void fuse_export_drained_begin(void *opaque)
 {
     FuseExport *exp = opaque;
 
-    aio_set_fd_handler(exp->common.ctx,
-                       fuse_session_fd(exp->fuse_session),
-                       NULL, NULL, NULL, NULL, NULL);
-    exp->fd_handler_set_up = false;
+    fuse_export_detach_queues(exp);
 }
 
 static void fuse_export_drained_end(void *opaque)
@@ -96,10 +200,12 @@ static void fuse_export_drained_end(void *opaque)
     /* Refresh AioContext in case it changed */
     exp->common.ctx = blk_get_aio_context(exp->common.blk);
 
-    aio_set_fd_handler(exp->common.ctx,
-                       fuse_session_fd(exp->fuse_session),
-                       read_from_fuse_export, NULL, NULL, NULL, exp);
-    exp->fd_handler_set_up = true;
+    /* Queues of a multi-threaded export stay in their iothreads */
+    if (!exp->common.multithread_ctxs && exp->num_queues > 0) {
+        exp->queues[0].ctx = exp->common.ctx;
+    }
+
+    fuse_export_attach_queues(exp);
 }
 
 static bool fuse_export_drained_poll(void *opaque)
@@ -114,7 +220,6 @@ static const BlockDevOps fuse_export_blk_dev_ops = {
     .drained_end   = fuse_export_drained_end,
     .drained_poll  = fuse_export_drained_poll,
 };
-
 static int fuse_export_create(BlockExport *blk_exp,
                               BlockExportOptions *blk_exp_args,
                               Error **errp)
@@ -190,6 +295,7 @@ static int fuse_export_create(BlockExport *blk_exp,
     }
     exp->st_uid = getuid();
     exp->st_gid = getgid();
+    qemu_co_mutex_init(&exp->resize_lock);
 
     if (args->allow_other == FUSE_EXPORT_ALLOW_OTHER_AUTO) {
         /* Ignore errors on our first attempt */
@@ -206,6 +312,14 @@ static int fuse_export_create(BlockExport *blk_exp,
         goto fail;
     }
 
+    ret = setup_fuse_queues(exp, errp);
+    if (ret < 0) {
+        fuse_export_shutdown(blk_exp);
+        goto fail;
+    }
+
+    fuse_export_attach_queues(exp);
+
     return 0;
 
 fail:
@@ -225,6 +339,7 @@ static void init_exports_table(void)
     exports = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 }
 
+
 /**
  * Create exp->fuse_session and mount it.
  */
@@ -236,10 +351,7 @@ static int setup_fuse_export(FuseExport *exp, const char *mountpoint,
     struct fuse_args fuse_args;
     int ret;
 
-    /*
-     * max_read needs to match what fuse_init() sets.
-     * max_write need not be supplied.
-     */
+    /* max_write is negotiated in fuse_init() */
     mount_opts = g_strdup_printf("max_read=%zu,default_permissions%s",
                                  FUSE_MAX_BOUNCE_BYTES,
                                  allow_other ? ",allow_other" : "");
@@ -269,11 +381,6 @@ static int setup_fuse_export(FuseExport *exp, const char *mountpoint,
 
     g_hash_table_insert(exports, g_strdup(mountpoint), NULL);
 
-    aio_set_fd_handler(exp->common.ctx,
-                       fuse_session_fd(exp->fuse_session),
-                       read_from_fuse_export, NULL, NULL, NULL, exp);
-    exp->fd_handler_set_up = true;
-
     return 0;
 
 fail:
@@ -282,28 +389,71 @@ fail:
 }
 
 /**
- * Callback to be invoked when the FUSE session FD can be read from.
- * (This is basically the FUSE event loop.)
+ * Set up one queue for every AioContext the export runs in.  Queues other
+ * than the first one get their own clone of the FUSE session fd, so the
+ * kernel distributes requests across them.
  */
-static void read_from_fuse_export(void *opaque)
+static int setup_fuse_queues(FuseExport *exp, Error **errp)
 {
-    FuseExport *exp = opaque;
-    int ret;
+    size_t num_queues = MAX(exp->common.multithread_count, 1);
+    int session_fd = fuse_session_fd(exp->fuse_session);
+
+#ifndef CONFIG_LINUX
+    if (num_queues > 1) {
+        error_setg(errp, "Multi-threaded FUSE exports are only supported on "
+                   "Linux");
+        return -ENOTSUP;
+    }
+#endif
 
-    blk_exp_ref(&exp->common);
+    exp->queues = g_new0(FuseQueue, num_queues);
 
-    qatomic_inc(&exp->in_flight);
+    for (size_t i = 0; i < num_queues; i++) {
+        FuseQueue *q = &exp->queues[i];
+        int fd = session_fd;
 
-    do {
-        ret = fuse_session_receive_buf(exp->fuse_session, &exp->fuse_buf);
-    } while (ret == -EINTR);
-    if (ret < 0) {
-        goto out;
+#ifdef CONFIG_LINUX
+        if (i > 0) {
+            uint32_t src_fd = session_fd;
+
+            fd = qemu_open("/dev/fuse", O_RDWR, errp);
+            if (fd < 0) {
+                return -EIO;
+            }
+
+            if (ioctl(fd, FUSE_DEV_IOC_CLONE, &src_fd) < 0) {
+                int ret = -errno;
+
+                error_setg_errno(errp, errno, "Failed to clone FUSE session");
+                close(fd);
+                return ret;
+            }
+        }
+#endif
+
+        /* Several queues may be woken up for the same request */
+        if (!qemu_set_blocking(fd, false, errp)) {
+            if (fd != session_fd) {
+                close(fd);
+            }
+            return -EIO;
+        }
+
+        *q = (FuseQueue) {
+            .exp         = exp,
+            .ctx         = exp->common.multithread_ctxs ?
+                           exp->common.multithread_ctxs[i] : exp->common.ctx,
+            .fuse_fd     = fd,
+            .request_buf = g_malloc(FUSE_REQUEST_BUF_SIZE),
+        };
+        exp->num_queues++;
     }
 
-    fuse_session_process_buf(exp->fuse_session, &exp->fuse_buf);
+    return 0;
+}
 
-out:
+static void fuse_dec_in_flight(FuseExport *exp)
+{
     if (qatomic_fetch_dec(&exp->in_flight) == 1) {
         aio_wait_kick(); /* wake AIO_WAIT_WHILE() */
     }
@@ -311,19 +461,56 @@ out:
     blk_exp_unref(&exp->common);
 }
 
-static void fuse_export_shutdown(BlockExport *blk_exp)
+static void coroutine_fn co_process_fuse_request(void *opaque);
+
+/**
+ * Callback to be invoked when a queue's FUSE fd can be read from.
+ * (This is basically the FUSE event loop.)
+ */
+static void read_from_fuse_queue(void *opaque)
 {
-    FuseExport *exp = container_of(blk_exp, FuseExport, common);
+    FuseQueue *q = opaque;
+    FuseExport *exp = q->exp;
+    const struct fuse_in_header *in_hdr = q->request_buf;
+    Coroutine *co;
+    ssize_t ret;
 
-    if (exp->fuse_session) {
-        fuse_session_exit(exp->fuse_session);
+    blk_exp_ref(&exp->common);
+
+    qatomic_inc(&exp->in_flight);
 
-        if (exp->fd_handler_set_up) {
-            aio_set_fd_handler(exp->common.ctx,
-                               fuse_session_fd(exp->fuse_session),
+    do {
+        ret = read(q->fuse_fd, q->request_buf, FUSE_REQUEST_BUF_SIZE);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        if (errno == ENODEV) {
+            /* Unmounted from the outside, the fd will stay readable */
+            aio_set_fd_handler(q->ctx, q->fuse_fd,
                                NULL, NULL, NULL, NULL, NULL);
-            exp->fd_handler_set_up = false;
         }
+        /* EAGAIN means that another queue got the request */
+        goto fail;
+    }
+
+    if (ret < sizeof(*in_hdr) || in_hdr->len != ret) {
+        goto fail;
+    }
+
+    q->request_len = ret;
+    co = qemu_coroutine_create(co_process_fuse_request, q);
+    qemu_coroutine_enter(co);
+    return;
+
+fail:
+    fuse_dec_in_flight(exp);
+}
+
+static void fuse_export_shutdown(BlockExport *blk_exp)
+{
+    FuseExport *exp = container_of(blk_exp, FuseExport, common);
+
+    if (exp->fd_handler_set_up) {
+        fuse_export_detach_queues(exp);
     }
 
     if (exp->mountpoint) {
@@ -339,6 +526,17 @@ static void fuse_export_delete(BlockExport *blk_exp)
 {
     FuseExport *exp = container_of(blk_exp, FuseExport, common);
 
+    for (size_t i = 0; i < exp->num_queues; i++) {
+        FuseQueue *q = &exp->queues[i];
+
+        /* Queue 0 uses the session fd, which belongs to libfuse */
+        if (i > 0) {
+            close(q->fuse_fd);
+        }
+        g_free(q->request_buf);
+    }
+    g_free(exp->queues);
+
     if (exp->fuse_session) {
         if (exp->mounted) {
             fuse_session_unmount(exp->fuse_session);
@@ -347,7 +545,6 @@ static void fuse_export_delete(BlockExport *blk_exp)
         fuse_session_destroy(exp->fuse_session);
     }
 
-    free(exp->fuse_buf.mem);
     g_free(exp->mountpoint);
 }
 
@@ -375,112 +572,126 @@ static bool is_regular_file(const char *path, Error **errp)
 }
 
 /**
- * A chance to set change some parameters supplied to FUSE_INIT.
+ * Negotiate the protocol and connection parameters with the kernel.
  */
-static void fuse_init(void *userdata, struct fuse_conn_info *conn)
+static ssize_t fuse_init(struct fuse_init_out *out,
+                         const struct fuse_init_in *in)
 {
-    /*
-     * MIN_NON_ZERO() would not be wrong here, but what we set here
-     * must equal what has been passed to fuse_session_new().
-     * Therefore, as long as max_read must be passed as a mount option
-     * (which libfuse claims will be changed at some point), we have
-     * to set max_read to a fixed value here.
-     */
-    conn->max_read = FUSE_MAX_BOUNCE_BYTES;
+    *out = (struct fuse_init_out) {
+        .major = FUSE_KERNEL_VERSION,
+        .minor = FUSE_KERNEL_MINOR_VERSION,
+    };
 
-    conn->max_write = MIN_NON_ZERO(BDRV_REQUEST_MAX_BYTES, conn->max_write);
-}
+    /* The kernel will retry with our major version */
+    if (in->major > FUSE_KERNEL_VERSION) {
+        return sizeof(*out);
+    }
 
-/**
- * Let clients look up files.  Always return ENOENT because we only
- * care about the mountpoint itself.
- */
-static void fuse_lookup(fuse_req_t req, fuse_ino_t parent, const char *name)
-{
-    fuse_reply_err(req, ENOENT);
+    if (in->major < FUSE_KERNEL_VERSION || in->minor < FUSE_MIN_KERNEL_MINOR) {
+        return -EPROTO;
+    }
+
+    /*
+     * Apart from FUSE_MAX_PAGES, these are the libfuse defaults that matter
+     * to us.  In particular, with FUSE_ATOMIC_O_TRUNC, the kernel does not
+     * truncate the image on open(O_TRUNC), but leaves O_TRUNC to FUSE_OPEN,
+     * which ignores it.
+     */
+    out->max_readahead = in->max_readahead;
+    out->flags = in->flags & FUSE_INIT_FLAGS;
+    out->max_background = FUSE_MAX_BACKGROUND;
+    out->congestion_threshold = FUSE_MAX_BACKGROUND * 3 / 4;
+    out->max_write = FUSE_MAX_WRITE_BYTES;
+    out->max_pages = FUSE_MAX_WRITE_BYTES / qemu_real_host_page_size();
+
+    return sizeof(*out);
 }
 
 /**
  * Let clients get file attributes (i.e., stat() the file).
  */
-static void fuse_getattr(fuse_req_t req, fuse_ino_t inode,
-                         struct fuse_file_info *fi)
+static ssize_t coroutine_fn
+fuse_co_getattr(FuseExport *exp, struct fuse_attr_out *out, uint64_t inode)
 {
-    struct stat statbuf;
     int64_t length, allocated_blocks;
     time_t now = time(NULL);
-    FuseExport *exp = fuse_req_userdata(req);
 
-    length = blk_getlength(exp->common.blk);
+    length = blk_co_getlength(exp->common.blk);
     if (length < 0) {
-        fuse_reply_err(req, -length);
-        return;
+        return length;
     }
 
-    allocated_blocks = bdrv_get_allocated_file_size(blk_bs(exp->common.blk));
+    WITH_GRAPH_RDLOCK_GUARD() {
+        allocated_blocks =
+            bdrv_co_get_allocated_file_size(blk_bs(exp->common.blk));
+    }
     if (allocated_blocks <= 0) {
         allocated_blocks = DIV_ROUND_UP(length, 512);
     } else {
         allocated_blocks = DIV_ROUND_UP(allocated_blocks, 512);
     }
 
-    statbuf = (struct stat) {
-        .st_ino     = inode,
-        .st_mode    = exp->st_mode,
-        .st_nlink   = 1,
-        .st_uid     = exp->st_uid,
-        .st_gid     = exp->st_gid,
-        .st_size    = length,
-        .st_blksize = blk_bs(exp->common.blk)->bl.request_alignment,
-        .st_blocks  = allocated_blocks,
-        .st_atime   = now,
-        .st_mtime   = now,
-        .st_ctime   = now,
+    *out = (struct fuse_attr_out) {
+        .attr_valid = 1,
+        .attr = {
+            .ino     = inode,
+            .mode    = qatomic_read(&exp->st_mode),
+            .nlink   = 1,
+            .uid     = qatomic_read(&exp->st_uid),
+            .gid     = qatomic_read(&exp->st_gid),
+            .size    = length,
+            .blksize = blk_bs(exp->common.blk)->bl.request_alignment,
+            .blocks  = allocated_blocks,
+            .atime   = now,
+            .mtime   = now,
+            .ctime   = now,
+        },
     };
 
-    fuse_reply_attr(req, &statbuf, 1.);
+    return sizeof(*out);
 }
 
-static int fuse_do_truncate(const FuseExport *exp, int64_t size,
-                            bool req_zero_write, PreallocMode prealloc)
+static int coroutine_fn
+fuse_co_do_truncate(const FuseExport *exp, int64_t size, bool req_zero_write,
+                    PreallocMode prealloc)
 {
-    uint64_t blk_perm, blk_shared_perm;
     BdrvRequestFlags truncate_flags = 0;
-    bool add_resize_perm;
-    int ret, ret_check;
 
-    /* Growable and writable exports have a permanent RESIZE permission */
-    add_resize_perm = !exp->growable && !exp->writable;
+    /*
+     * Only writable exports are truncated, and growable and writable exports
+     * have a permanent RESIZE permission
+     */
+    assert(exp->writable || exp->growable);
 
     if (req_zero_write) {
         truncate_flags |= BDRV_REQ_ZERO_WRITE;
     }
 
-    if (add_resize_perm) {
-
-        if (!qemu_in_main_thread()) {
-            /* Changing permissions like below only works in the main thread */
-            return -EPERM;
-        }
-
-        blk_get_perm(exp->common.blk, &blk_perm, &blk_shared_perm);
-
-        ret = blk_set_perm(exp->common.blk, blk_perm | BLK_PERM_RESIZE,
-                           blk_shared_perm, NULL);
-        if (ret < 0) {
-            return ret;
-        }
-    }
+    return blk_co_truncate(exp->common.blk, size, true, prealloc,
+                           truncate_flags, NULL);
+}
 
-    ret = blk_truncate(exp->common.blk, size, true, prealloc,
-                       truncate_flags, NULL);
+/**
+ * Grow the image to at least @size bytes.  Requests run concurrently, so the
+ * length is checked again under resize_lock: another request may have grown
+ * the image beyond @size in the meantime, and truncating to @size would then
+ * shrink it again and drop that request's data.
+ */
+static int coroutine_fn
+fuse_co_grow(FuseExport *exp, int64_t size, bool req_zero_write,
+             PreallocMode prealloc)
+{
+    int64_t length;
+    int ret = 0;
 
-    if (add_resize_perm) {
-        /* Must succeed, because we are only giving up the RESIZE permission */
-        ret_check = blk_set_perm(exp->common.blk, blk_perm,
-                                 blk_shared_perm, &error_abort);
-        assert(ret_check == 0);
+    qemu_co_mutex_lock(&exp->resize_lock);
+    length = blk_co_getlength(exp->common.blk);
+    if (length < 0) {
+        ret = length;
+    } else if (size > length) {
+        ret = fuse_co_do_truncate(exp, size, req_zero_write, prealloc);
     }
+    qemu_co_mutex_unlock(&exp->resize_lock);
 
     return ret;
 }
@@ -493,108 +704,106 @@ static int fuse_do_truncate(const FuseExport *exp, int64_t size,
  * without allow_other cannot be given a different UID or GID, and
  * they cannot be given non-owner access.
  */
-static void fuse_setattr(fuse_req_t req, fuse_ino_t inode, struct stat *statbuf,
-                         int to_set, struct fuse_file_info *fi)
+static ssize_t coroutine_fn
+fuse_co_setattr(FuseExport *exp, struct fuse_attr_out *out, uint64_t inode,
+                const struct fuse_setattr_in *in)
 {
-    FuseExport *exp = fuse_req_userdata(req);
-    int supported_attrs;
+    uint32_t to_set, supported_attrs;
     int ret;
 
-    supported_attrs = FUSE_SET_ATTR_SIZE | FUSE_SET_ATTR_MODE;
+    /* These only tell which file handle the request came through */
+    to_set = in->valid & ~(FATTR_FH | FATTR_LOCKOWNER);
+
+    supported_attrs = FATTR_SIZE | FATTR_MODE;
     if (exp->allow_other) {
-        supported_attrs |= FUSE_SET_ATTR_UID | FUSE_SET_ATTR_GID;
+        supported_attrs |= FATTR_UID | FATTR_GID;
     }
 
     if (to_set & ~supported_attrs) {
-        fuse_reply_err(req, ENOTSUP);
-        return;
+        return -ENOTSUP;
     }
 
     /* Do some argument checks first before committing to anything */
-    if (to_set & FUSE_SET_ATTR_MODE) {
+    if (to_set & FATTR_MODE) {
         /*
          * Without allow_other, non-owners can never access the export, so do
          * not allow setting permissions for them
          */
-        if (!exp->allow_other &&
-            (statbuf->st_mode & (S_IRWXG | S_IRWXO)) != 0)
-        {
-            fuse_reply_err(req, EPERM);
-            return;
+        if (!exp->allow_other && (in->mode & (S_IRWXG | S_IRWXO)) != 0) {
+            return -EPERM;
         }
 
         /* +w for read-only exports makes no sense, disallow it */
-        if (!exp->writable &&
-            (statbuf->st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)) != 0)
-        {
-            fuse_reply_err(req, EROFS);
-            return;
+        if (!exp->writable && (in->mode & (S_IWUSR | S_IWGRP | S_IWOTH)) != 0) {
+            return -EROFS;
         }
     }
 
-    if (to_set & FUSE_SET_ATTR_SIZE) {
+    if (to_set & FATTR_SIZE) {
         if (!exp->writable) {
-            fuse_reply_err(req, EACCES);
-            return;
+            return -EACCES;
         }
 
-        ret = fuse_do_truncate(exp, statbuf->st_size, true, PREALLOC_MODE_OFF);
+        qemu_co_mutex_lock(&exp->resize_lock);
+        ret = fuse_co_do_truncate(exp, in->size, true, PREALLOC_MODE_OFF);
+        qemu_co_mutex_unlock(&exp->resize_lock);
         if (ret < 0) {
-            fuse_reply_err(req, -ret);
-            return;
+            return ret;
         }
     }
 
-    if (to_set & FUSE_SET_ATTR_MODE) {
+    if (to_set & FATTR_MODE) {
         /* Ignore FUSE-supplied file type, only change the mode */
-        exp->st_mode = (statbuf->st_mode & 07777) | S_IFREG;
+        qatomic_set(&exp->st_mode, (in->mode & 07777) | S_IFREG);
     }
 
-    if (to_set & FUSE_SET_ATTR_UID) {
-        exp->st_uid = statbuf->st_uid;
+    if (to_set & FATTR_UID) {
+        qatomic_set(&exp->st_uid, in->uid);
     }
 
-    if (to_set & FUSE_SET_ATTR_GID) {
-        exp->st_gid = statbuf->st_gid;
+    if (to_set & FATTR_GID) {
+        qatomic_set(&exp->st_gid, in->gid);
     }
 
-    fuse_getattr(req, inode, fi);
+    return fuse_co_getattr(exp, out, inode);
 }
 
 /**
  * Let clients open a file (i.e., the exported image).
  */
-static void fuse_open(fuse_req_t req, fuse_ino_t inode,
-                      struct fuse_file_info *fi)
+static ssize_t fuse_open(struct fuse_open_out *out)
 {
-    fuse_reply_open(req, fi);
+    *out = (struct fuse_open_out) {};
+    return sizeof(*out);
 }
 
 /**
- * Handle client reads from the exported image.
+ * Handle client reads from the exported image.  On success, *bufptr is a
+ * bounce buffer holding the returned number of bytes.
  */
-static void fuse_read(fuse_req_t req, fuse_ino_t inode,
-                      size_t size, off_t offset, struct fuse_file_info *fi)
+static ssize_t coroutine_fn
+fuse_co_read(FuseExport *exp, void **bufptr, uint64_t offset, uint32_t size)
 {
-    FuseExport *exp = fuse_req_userdata(req);
     int64_t length;
     void *buf;
     int ret;
 
     /* Limited by max_read, should not happen */
     if (size > FUSE_MAX_BOUNCE_BYTES) {
-        fuse_reply_err(req, EINVAL);
-        return;
+        return -EINVAL;
     }
 
     /**
      * Clients will expect short reads at EOF, so we have to limit
      * offset+size to the image length.
      */
-    length = blk_getlength(exp->common.blk);
+    length = blk_co_getlength(exp->common.blk);
     if (length < 0) {
-        fuse_reply_err(req, -length);
-        return;
+        return length;
+    }
+
+    if (offset >= length) {
+        return 0;
     }
 
     if (offset + size > length) {
@@ -603,91 +812,81 @@ static void fuse_read(fuse_req_t req, fuse_ino_t inode,
 
     buf = qemu_try_blockalign(blk_bs(exp->common.blk), size);
     if (!buf) {
-        fuse_reply_err(req, ENOMEM);
-        return;
+        return -ENOMEM;
     }
 
-    ret = blk_pread(exp->common.blk, offset, size, buf, 0);
-    if (ret >= 0) {
-        fuse_reply_buf(req, buf, size);
-    } else {
-        fuse_reply_err(req, -ret);
+    ret = blk_co_pread(exp->common.blk, offset, size, buf, 0);
+    if (ret < 0) {
+        qemu_vfree(buf);
+        return ret;
     }
 
-    qemu_vfree(buf);
+    *bufptr = buf;
+    return size;
 }
 
 /**
  * Handle client writes to the exported image.
  */
-static void fuse_write(fuse_req_t req, fuse_ino_t inode, const char *buf,
-                       size_t size, off_t offset, struct fuse_file_info *fi)
+static ssize_t coroutine_fn
+fuse_co_write(FuseExport *exp, struct fuse_write_out *out,
+              uint64_t offset, uint32_t size, const void *buf)
 {
-    FuseExport *exp = fuse_req_userdata(req);
     int64_t length;
     int ret;
 
-    /* Limited by max_write, should not happen */
-    if (size > BDRV_REQUEST_MAX_BYTES) {
-        fuse_reply_err(req, EINVAL);
-        return;
-    }
-
     if (!exp->writable) {
-        fuse_reply_err(req, EACCES);
-        return;
+        return -EACCES;
     }
 
     /**
      * Clients will expect short writes at EOF, so we have to limit
      * offset+size to the image length.
      */
-    length = blk_getlength(exp->common.blk);
+    length = blk_co_getlength(exp->common.blk);
     if (length < 0) {
-        fuse_reply_err(req, -length);
-        return;
+        return length;
     }
 
     if (offset + size > length) {
         if (exp->growable) {
-            ret = fuse_do_truncate(exp, offset + size, true, PREALLOC_MODE_OFF);
+            ret = fuse_co_grow(exp, offset + size, true, PREALLOC_MODE_OFF);
             if (ret < 0) {
-                fuse_reply_err(req, -ret);
-                return;
+                return ret;
             }
         } else {
-            size = length - offset;
+            size = offset < length ? length - offset : 0;
         }
     }
 
-    ret = blk_pwrite(exp->common.blk, offset, size, buf, 0);
-    if (ret >= 0) {
-        fuse_reply_write(req, size);
-    } else {
-        fuse_reply_err(req, -ret);
+    ret = blk_co_pwrite(exp->common.blk, offset, size, buf, 0);
+    if (ret < 0) {
+        return ret;
     }
+
+    *out = (struct fuse_write_out) {
+        .size = size,
+    };
+    return sizeof(*out);
 }
 
 /**
  * Let clients perform various fallocate() operations.
  */
-static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
-                           off_t offset, off_t length,
-                           struct fuse_file_info *fi)
+static int coroutine_fn
+fuse_co_fallocate(FuseExport *exp, int64_t offset, int64_t length,
+                  uint32_t mode)
 {
-    FuseExport *exp = fuse_req_userdata(req);
     int64_t blk_len;
     int ret;
 
     if (!exp->writable) {
-        fuse_reply_err(req, EACCES);
-        return;
+        return -EACCES;
     }
 
-    blk_len = blk_getlength(exp->common.blk);
+    blk_len = blk_co_getlength(exp->common.blk);
     if (blk_len < 0) {
-        fuse_reply_err(req, -blk_len);
-        return;
+        return blk_len;
     }
 
 #ifdef CONFIG_FALLOCATE_PUNCH_HOLE
@@ -699,34 +898,32 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
     if (!mode) {
         /* We can only fallocate at the EOF with a truncate */
         if (offset < blk_len) {
-            fuse_reply_err(req, EOPNOTSUPP);
-            return;
+            return -EOPNOTSUPP;
         }
 
         if (offset > blk_len) {
             /* No preallocation needed here */
-            ret = fuse_do_truncate(exp, offset, true, PREALLOC_MODE_OFF);
+            ret = fuse_co_grow(exp, offset, true, PREALLOC_MODE_OFF);
             if (ret < 0) {
-                fuse_reply_err(req, -ret);
-                return;
+                return ret;
             }
         }
 
-        ret = fuse_do_truncate(exp, offset + length, true,
-                               PREALLOC_MODE_FALLOC);
+        ret = fuse_co_grow(exp, offset + length, true,
+                           PREALLOC_MODE_FALLOC);
     }
 #ifdef CONFIG_FALLOCATE_PUNCH_HOLE
     else if (mode & FALLOC_FL_PUNCH_HOLE) {
         if (!(mode & FALLOC_FL_KEEP_SIZE)) {
-            fuse_reply_err(req, EINVAL);
-            return;
+            return -EINVAL;
         }
 
         do {
             int size = MIN(length, BDRV_REQUEST_MAX_BYTES);
 
-            ret = blk_pwrite_zeroes(exp->common.blk, offset, size,
-                                    BDRV_REQ_MAY_UNMAP | BDRV_REQ_NO_FALLBACK);
+            ret = blk_co_pwrite_zeroes(exp->common.blk, offset, size,
+                                       BDRV_REQ_MAY_UNMAP |
+                                       BDRV_REQ_NO_FALLBACK);
             if (ret == -ENOTSUP) {
                 /*
                  * fallocate() specifies to return EOPNOTSUPP for unsupported
@@ -744,19 +941,17 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
     else if (mode & FALLOC_FL_ZERO_RANGE) {
         if (!(mode & FALLOC_FL_KEEP_SIZE) && offset + length > blk_len) {
             /* No need for zeroes, we are going to write them ourselves */
-            ret = fuse_do_truncate(exp, offset + length, false,
-                                   PREALLOC_MODE_OFF);
+            ret = fuse_co_grow(exp, offset + length, false,
+                               PREALLOC_MODE_OFF);
             if (ret < 0) {
-                fuse_reply_err(req, -ret);
-                return;
+                return ret;
             }
         }
 
         do {
             int size = MIN(length, BDRV_REQUEST_MAX_BYTES);
 
-            ret = blk_pwrite_zeroes(exp->common.blk,
-                                    offset, size, 0);
+            ret = blk_co_pwrite_zeroes(exp->common.blk, offset, size, 0);
             offset += size;
             length -= size;
         } while (ret == 0 && length > 0);
@@ -766,55 +961,53 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
         ret = -EOPNOTSUPP;
     }
 
-    fuse_reply_err(req, ret < 0 ? -ret : 0);
+    return ret < 0 ? ret : 0;
 }
 
 /**
- * Let clients fsync the exported image.
+ * Let clients fsync the exported image.  This also serves FUSE_FLUSH, which
+ * is sent before an FD to the exported image is closed.  (libfuse notes this
+ * to be a way to return last-minute errors.)
  */
-static void fuse_fsync(fuse_req_t req, fuse_ino_t inode, int datasync,
-                       struct fuse_file_info *fi)
+static int coroutine_fn fuse_co_fsync(FuseExport *exp)
 {
-    FuseExport *exp = fuse_req_userdata(req);
-    int ret;
-
-    ret = blk_flush(exp->common.blk);
-    fuse_reply_err(req, ret < 0 ? -ret : 0);
+    return blk_co_flush(exp->common.blk);
 }
 
 /**
- * Called before an FD to the exported image is closed.  (libfuse
- * notes this to be a way to return last-minute errors.)
+ * Report the same file system statistics libfuse reports by default.
  */
-static void fuse_flush(fuse_req_t req, fuse_ino_t inode,
-                        struct fuse_file_info *fi)
+static ssize_t fuse_statfs(struct fuse_statfs_out *out)
 {
-    fuse_fsync(req, inode, 1, fi);
+    *out = (struct fuse_statfs_out) {
+        .st = {
+            .bsize   = 512,
+            .namelen = 255,
+        },
+    };
+    return sizeof(*out);
 }
 
 #ifdef CONFIG_FUSE_LSEEK
 /**
  * Let clients inquire allocation status.
  */
-static void fuse_lseek(fuse_req_t req, fuse_ino_t inode, off_t offset,
-                       int whence, struct fuse_file_info *fi)
+static ssize_t coroutine_fn
+fuse_co_lseek(FuseExport *exp, struct fuse_lseek_out *out,
+              uint64_t offset, uint32_t whence)
 {
-    FuseExport *exp = fuse_req_userdata(req);
-
     if (whence != SEEK_HOLE && whence != SEEK_DATA) {
-        fuse_reply_err(req, EINVAL);
-        return;
+        return -EINVAL;
     }
 
     while (true) {
         int64_t pnum;
         int ret;
 
-        ret = bdrv_block_status_above(blk_bs(exp->common.blk), NULL,
-                                      offset, INT64_MAX, &pnum, NULL, NULL);
+        ret = blk_co_block_status_above(exp->common.blk, NULL, offset,
+                                        INT64_MAX, &pnum, NULL, NULL);
         if (ret < 0) {
-            fuse_reply_err(req, -ret);
-            return;
+            return ret;
         }
 
         if (!pnum && (ret & BDRV_BLOCK_EOF)) {
@@ -829,62 +1022,235 @@ static void fuse_lseek(fuse_req_t req, fuse_ino_t inode, off_t offset,
              * and @blk_len (the client-visible EOF).
              */
 
-            blk_len = blk_getlength(exp->common.blk);
+            blk_len = blk_co_getlength(exp->common.blk);
             if (blk_len < 0) {
-                fuse_reply_err(req, -blk_len);
-                return;
+                return blk_len;
             }
 
             if (offset > blk_len || whence == SEEK_DATA) {
-                fuse_reply_err(req, ENXIO);
-            } else {
-                fuse_reply_lseek(req, offset);
+                return -ENXIO;
             }
-            return;
+            break;
         }
 
         if (ret & BDRV_BLOCK_DATA) {
             if (whence == SEEK_DATA) {
-                fuse_reply_lseek(req, offset);
-                return;
+                break;
             }
         } else {
             if (whence == SEEK_HOLE) {
-                fuse_reply_lseek(req, offset);
-                return;
+                break;
             }
         }
 
         /* Safety check against infinite loops */
         if (!pnum) {
-            fuse_reply_err(req, ENXIO);
-            return;
+            return -ENXIO;
         }
 
         offset += pnum;
     }
+
+    *out = (struct fuse_lseek_out) {
+        .offset = offset,
+    };
+    return sizeof(*out);
 }
 #endif
 
-static const struct fuse_lowlevel_ops fuse_ops = {
-    .init       = fuse_init,
-    .lookup     = fuse_lookup,
-    .getattr    = fuse_getattr,
-    .setattr    = fuse_setattr,
-    .open       = fuse_open,
-    .read       = fuse_read,
-    .write      = fuse_write,
-    .fallocate  = fuse_fallocate,
-    .flush      = fuse_flush,
-    .fsync      = fuse_fsync,
+/**
+ * Minimum size of the arguments following the header of @opcode requests.
+ */
+static size_t fuse_in_args_size(uint32_t opcode)
+{
+    switch (opcode) {
+    case FUSE_INIT:
+        /* Kernels before 7.36 do not send flags2 and the fields after it */
+        return offsetof(struct fuse_init_in, flags2);
+    case FUSE_SETATTR:
+        return sizeof(struct fuse_setattr_in);
+    case FUSE_READ:
+        return sizeof(struct fuse_read_in);
+    case FUSE_WRITE:
+        return sizeof(struct fuse_write_in);
+    case FUSE_FALLOCATE:
+        return sizeof(struct fuse_fallocate_in);
+    case FUSE_LSEEK:
+        return sizeof(struct fuse_lseek_in);
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Send the reply to request @unique.  @error is a negative errno value or 0;
+ * @out is only sent on success.
+ */
+static void fuse_send_reply(FuseQueue *q, uint64_t unique, int error,
+                            const void *out, size_t out_len)
+{
+    struct fuse_out_header out_hdr = {
+        .len    = sizeof(out_hdr) + (error ? 0 : out_len),
+        .error  = error,
+        .unique = unique,
+    };
+    struct iovec iov[] = {
+        { .iov_base = &out_hdr,    .iov_len = sizeof(out_hdr) },
+        { .iov_base = (void *)out, .iov_len = out_len },
+    };
+    ssize_t ret;
+
+    /*
+     * Failure is not fatal: ENOENT means that the request was interrupted,
+     * ENODEV that the export has been unmounted.
+     */
+    do {
+        ret = writev(q->fuse_fd, iov, error || !out_len ? 1 : 2);
+    } while (ret < 0 && errno == EINTR);
+}
+
+/**
+ * Process the request in the request buffer of the FuseQueue @opaque and
+ * send the reply on the same queue.
+ */
+static void coroutine_fn co_process_fuse_request(void *opaque)
+{
+    FuseQueue *q = opaque;
+    FuseExport *exp = q->exp;
+    struct fuse_in_header in_hdr;
+    union {
+        struct fuse_init_in init;
+        struct fuse_setattr_in setattr;
+        struct fuse_read_in read;
+        struct fuse_write_in write;
+        struct fuse_fallocate_in fallocate;
+        struct fuse_lseek_in lseek;
+    } in = {};
+    union {
+        struct fuse_init_out init;
+        struct fuse_attr_out attr;
+        struct fuse_open_out open;
+        struct fuse_write_out write;
+        struct fuse_statfs_out statfs;
+        struct fuse_lseek_out lseek;
+    } out;
+    const void *reply = &out;
+    void *read_buf = NULL;
+    void *write_buf = NULL;
+    size_t in_len;
+    ssize_t ret;
+
+    /*
+     * Copy everything we need out of the request buffer before anything can
+     * yield, because the buffer is reused for the next request then.
+     */
+    memcpy(&in_hdr, q->request_buf, sizeof(in_hdr));
+    in_len = q->request_len - sizeof(in_hdr);
+    memcpy(&in, q->request_buf + sizeof(in_hdr), MIN(in_len, sizeof(in)));
+
+    if (in_len < fuse_in_args_size(in_hdr.opcode)) {
+        ret = -EINVAL;
+        goto reply;
+    }
+
+    if (in_hdr.opcode == FUSE_WRITE) {
+        if (in.write.size > in_len - sizeof(in.write)) {
+            ret = -EINVAL;
+            goto reply;
+        }
+
+        write_buf = qemu_try_blockalign(blk_bs(exp->common.blk),
+                                        in.write.size);
+        if (!write_buf) {
+            ret = -ENOMEM;
+            goto reply;
+        }
+        memcpy(write_buf, q->request_buf + sizeof(in_hdr) + sizeof(in.write),
+               in.write.size);
+    }
+
+    switch (in_hdr.opcode) {
+    case FUSE_INIT:
+        ret = fuse_init(&out.init, &in.init);
+        break;
+
+    case FUSE_DESTROY:
+    case FUSE_RELEASE:
+        ret = 0;
+        break;
+
+    case FUSE_FORGET:
+    case FUSE_BATCH_FORGET:
+    case FUSE_INTERRUPT:
+        /* These do not get a reply */
+        goto out;
+
+    case FUSE_LOOKUP:
+        /* We only care about the mountpoint itself */
+        ret = -ENOENT;
+        break;
+
+    case FUSE_GETATTR:
+        ret = fuse_co_getattr(exp, &out.attr, in_hdr.nodeid);
+        break;
+
+    case FUSE_SETATTR:
+        ret = fuse_co_setattr(exp, &out.attr, in_hdr.nodeid, &in.setattr);
+        break;
+
+    case FUSE_OPEN:
+        ret = fuse_open(&out.open);
+        break;
+
+    case FUSE_READ:
+        ret = fuse_co_read(exp, &read_buf, in.read.offset, in.read.size);
+        reply = read_buf;
+        break;
+
+    case FUSE_WRITE:
+        ret = fuse_co_write(exp, &out.write, in.write.offset, in.write.size,
+                            write_buf);
+        break;
+
+    case FUSE_FALLOCATE:
+        ret = fuse_co_fallocate(exp, in.fallocate.offset,
+                                in.fallocate.length, in.fallocate.mode);
+        break;
+
+    case FUSE_FSYNC:
+    case FUSE_FLUSH:
+        ret = fuse_co_fsync(exp);
+        break;
+
+    case FUSE_STATFS:
+        ret = fuse_statfs(&out.statfs);
+        break;
+
 #ifdef CONFIG_FUSE_LSEEK
-    .lseek      = fuse_lseek,
+    case FUSE_LSEEK:
+        ret = fuse_co_lseek(exp, &out.lseek, in.lseek.offset,
+                            in.lseek.whence);
+        break;
 #endif
-};
+
+    default:
+        ret = -ENOSYS;
+        break;
+    }
+
+reply:
+    fuse_send_reply(q, in_hdr.unique, MIN(ret, 0), reply, MAX(ret, 0));
+
+out:
+    qemu_vfree(read_buf);
+    qemu_vfree(write_buf);
+    fuse_dec_in_flight(exp);
+}
 
 const BlockExportDriver blk_exp_fuse = {
     .type               = BLOCK_EXPORT_TYPE_FUSE,
     .instance_size      = sizeof(FuseExport),
+    .supports_multithread = true,
     .create             = fuse_export_create,
     .delete             = fuse_export_delete,
     .request_shutdown   = fuse_export_shutdown,
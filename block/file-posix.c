@@ -2678,6 +2678,65 @@ raw_co_pwritev(BlockDriverState *bs, int64_t offset, int64_t bytes,
     return raw_co_prw(bs, &offset, bytes, qiov, QEMU_AIO_WRITE, flags);
 }
 
+typedef struct RawPosixFastRead {
+    RawPosixAIOData acb;
+    BlockCompletionFunc *cb;
+    void *opaque;
+} RawPosixFastRead;
+
+static void raw_aio_preadv_fast_cb(void *opaque, int ret)
+{
+    RawPosixFastRead *fr = opaque;
+
+    fr->cb(fr->opaque, ret);
+    g_free(fr);
+}
+
+/*
+ * Reads that raw_co_prw() would hand to the thread pool are submitted to it
+ * directly. Linux AIO and io_uring are only used from coroutines, so with
+ * those the read takes the coroutine path unless it is misaligned.
+ */
+static bool GRAPH_RDLOCK
+raw_aio_preadv_fast(BlockDriverState *bs, int64_t offset, int64_t bytes,
+                    QEMUIOVector *qiov, BlockCompletionFunc *cb, void *opaque)
+{
+    BDRVRawState *s = bs->opaque;
+    RawPosixFastRead *fr;
+    int type = QEMU_AIO_READ;
+
+    if (fd_open(bs) < 0) {
+        return false;
+    }
+
+    if (s->needs_alignment && !bdrv_qiov_is_aligned(bs, qiov)) {
+        type |= QEMU_AIO_MISALIGNED;
+    } else if (s->use_linux_aio || s->use_linux_io_uring) {
+        return false;
+    }
+
+    fr = g_new(RawPosixFastRead, 1);
+    *fr = (RawPosixFastRead) {
+        .acb = {
+            .bs             = bs,
+            .aio_fildes     = s->fd,
+            .aio_type       = type,
+            .aio_offset     = offset,
+            .aio_nbytes     = bytes,
+            .io             = {
+                .iov            = qiov->iov,
+                .niov           = qiov->niov,
+            },
+        },
+        .cb     = cb,
+        .opaque = opaque,
+    };
+
+    thread_pool_submit_aio(handle_aiocb_rw, &fr->acb,
+                           raw_aio_preadv_fast_cb, fr);
+    return true;
+}
+
 static int coroutine_fn raw_co_flush_to_disk(BlockDriverState *bs)
 {
     BDRVRawState *s = bs->opaque;
@@ -3999,6 +4058,7 @@ BlockDriver bdrv_file = {
     .bdrv_co_delete_file = raw_co_delete_file,
 
     .bdrv_co_preadv         = raw_co_preadv,
+    .bdrv_aio_preadv_fast   = raw_aio_preadv_fast,
     .bdrv_co_pwritev        = raw_co_pwritev,
     .bdrv_co_flush_to_disk  = raw_co_flush_to_disk,
     .bdrv_co_pdiscard       = raw_co_pdiscard,
@@ -4469,6 +4529,7 @@ static BlockDriver bdrv_host_device = {
     .bdrv_co_pwrite_zeroes = hdev_co_pwrite_zeroes,
 
     .bdrv_co_preadv         = raw_co_preadv,
+    .bdrv_aio_preadv_fast   = raw_aio_preadv_fast,
     .bdrv_co_pwritev        = raw_co_pwritev,
     .bdrv_co_flush_to_disk  = raw_co_flush_to_disk,
     .bdrv_co_pdiscard       = hdev_co_pdiscard,
@@ -421,6 +421,14 @@ static BlockAIOCB *raw_aio_preadv(BlockDriverState *bs,
     }
 }
 
+static bool raw_aio_preadv_fast(BlockDriverState *bs,
+                                int64_t offset, int64_t bytes,
+                                QEMUIOVector *qiov,
+                                BlockCompletionFunc *cb, void *opaque)
+{
+    return raw_aio_preadv(bs, offset, bytes, qiov, 0, cb, opaque) != NULL;
+}
+
 static BlockAIOCB *raw_aio_pwritev(BlockDriverState *bs,
                                    int64_t offset, int64_t bytes,
                                    QEMUIOVector *qiov, BdrvRequestFlags flags,
@@ -725,6 +733,7 @@ BlockDriver bdrv_file = {
     .bdrv_reopen_abort   = raw_reopen_abort,
 
     .bdrv_aio_preadv    = raw_aio_preadv,
+    .bdrv_aio_preadv_fast = raw_aio_preadv_fast,
     .bdrv_aio_pwritev   = raw_aio_pwritev,
     .bdrv_aio_flush     = raw_aio_flush,
 
@@ -893,6 +902,7 @@ static BlockDriver bdrv_host_device = {
     .bdrv_refresh_limits    = hdev_refresh_limits,
 
     .bdrv_aio_preadv    = raw_aio_preadv,
+    .bdrv_aio_preadv_fast = raw_aio_preadv_fast,
     .bdrv_aio_pwritev   = raw_aio_pwritev,
     .bdrv_aio_flush     = raw_aio_flush,
 
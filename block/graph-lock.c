@@ -288,6 +288,54 @@ void coroutine_fn bdrv_graph_co_rdunlock(void)
     }
 }
 
+bool no_coroutine_fn bdrv_graph_rdlock_try(void)
+{
+    AioContext *ctx = qemu_get_current_aio_context();
+    BdrvGraphRWlock *bdrv_graph;
+
+    assert(!qemu_in_coroutine());
+    if (!ctx) {
+        return false;
+    }
+    bdrv_graph = ctx->bdrv_graph;
+
+    qatomic_set(&bdrv_graph->reader_count, bdrv_graph->reader_count + 1);
+    /* make sure writer sees reader_count before we check has_writer */
+    smp_mb();
+
+    if (!qatomic_read(&has_writer)) {
+        return true;
+    }
+
+    /*
+     * Same as the slow path of bdrv_graph_co_rdlock(), except that we
+     * cannot sleep: drop the reader again and let the caller fall back
+     * to a coroutine.
+     */
+    WITH_QEMU_LOCK_GUARD(&aio_context_list_lock) {
+        bdrv_graph->reader_count--;
+        aio_wait_kick();
+    }
+    return false;
+}
+
+void no_coroutine_fn bdrv_graph_rdunlock_nocoroutine(void)
+{
+    BdrvGraphRWlock *bdrv_graph;
+
+    assert(!qemu_in_coroutine());
+    bdrv_graph = qemu_get_current_aio_context()->bdrv_graph;
+
+    qatomic_store_release(&bdrv_graph->reader_count,
+                          bdrv_graph->reader_count - 1);
+    /* make sure writer sees reader_count before we check has_writer */
+    smp_mb();
+
+    if (qatomic_read(&has_writer)) {
+        aio_wait_kick();
+    }
+}
+
 void bdrv_graph_rdlock_main_loop(void)
 {
     GLOBAL_STATE_CODE();
@@ -1833,6 +1833,135 @@ fail:
     return ret;
 }
 
+typedef struct BdrvFastRead {
+    BdrvTrackedRequest req;
+    BlockCompletionFunc *cb;
+    void *opaque;
+} BdrvFastRead;
+
+/*
+ * Add a read that is submitted outside of coroutine context to the tracked
+ * requests, so that serialising requests that start later wait for it like
+ * for any other request.  Fails if an overlapping serialising request is
+ * already in flight: the read then has to take the coroutine path, which
+ * waits for it.
+ */
+static bool tracked_request_begin_fast(BdrvTrackedRequest *req,
+                                       BlockDriverState *bs,
+                                       int64_t offset, int64_t bytes)
+{
+    BdrvTrackedRequest *r;
+
+    *req = (BdrvTrackedRequest){
+        .bs = bs,
+        .offset         = offset,
+        .bytes          = bytes,
+        .type           = BDRV_TRACKED_READ,
+        .overlap_offset = offset,
+        .overlap_bytes  = bytes,
+    };
+
+    qemu_co_queue_init(&req->wait_queue);
+
+    QEMU_LOCK_GUARD(&bs->reqs_lock);
+    QLIST_FOREACH(r, &bs->tracked_requests, list) {
+        if (r->serialising && tracked_request_overlaps(r, offset, bytes)) {
+            return false;
+        }
+    }
+    QLIST_INSERT_HEAD(&bs->tracked_requests, req, list);
+    return true;
+}
+
+static void tracked_request_end_fast(BdrvTrackedRequest *req)
+{
+    qemu_mutex_lock(&req->bs->reqs_lock);
+    QLIST_REMOVE(req, list);
+    qemu_mutex_unlock(&req->bs->reqs_lock);
+
+    /* Same as in tracked_request_end(), but we are not in a coroutine */
+    qemu_co_enter_all(&req->wait_queue, NULL);
+}
+
+static void bdrv_aio_preadv_fast_cb(void *opaque, int ret)
+{
+    BdrvFastRead *fr = opaque;
+    BlockDriverState *bs = fr->req.bs;
+    BlockCompletionFunc *cb = fr->cb;
+    void *cb_opaque = fr->opaque;
+
+    tracked_request_end_fast(&fr->req);
+    bdrv_dec_in_flight(bs);
+    g_free(fr);
+
+    cb(cb_opaque, ret);
+}
+
+/*
+ * Submit a read through the .bdrv_aio_preadv_fast callback of the driver,
+ * without entering a coroutine. This only covers requests for which
+ * bdrv_co_preadv_part() would do nothing but track the request and call the
+ * driver: no flags, aligned to request_alignment, within max_transfer and
+ * the image size, and no copy-on-read. The read is tracked like any other,
+ * so serialising requests wait for it; if one already overlaps it, the
+ * read takes the coroutine path.
+ *
+ * Must be called with the graph lock held, and the caller must keep it
+ * until @cb has run. Returns false without calling @cb if the request must
+ * take the coroutine path.
+ */
+bool no_coroutine_fn GRAPH_RDLOCK
+bdrv_aio_preadv_fast(BdrvChild *child, int64_t offset, int64_t bytes,
+                     QEMUIOVector *qiov, BlockCompletionFunc *cb, void *opaque)
+{
+    BlockDriverState *bs = child->bs;
+    BlockDriver *drv = bs->drv;
+    BdrvFastRead *fr;
+    uint32_t align;
+    IO_CODE();
+
+    if (!drv || !drv->bdrv_aio_preadv_fast || drv->bdrv_co_is_inserted ||
+        bs->bl.has_variable_length ||
+        bdrv_get_aio_context(bs) != qemu_get_current_aio_context()) {
+        return false;
+    }
+
+    if (qatomic_read(&bs->copy_on_read) ||
+        qatomic_read(&bs->serialising_in_flight)) {
+        return false;
+    }
+
+    align = bs->bl.request_alignment;
+    if (bytes == 0 || bytes != qiov->size ||
+        !QEMU_IS_ALIGNED(offset, align) || !QEMU_IS_ALIGNED(bytes, align) ||
+        bytes > MIN_NON_ZERO(bs->bl.max_transfer, INT_MAX) ||
+        bdrv_check_request32(offset, bytes, qiov, 0) < 0 ||
+        offset + bytes > bs->total_sectors * BDRV_SECTOR_SIZE) {
+        return false;
+    }
+
+    fr = g_new(BdrvFastRead, 1);
+    fr->cb = cb;
+    fr->opaque = opaque;
+    if (!tracked_request_begin_fast(&fr->req, bs, offset, bytes)) {
+        g_free(fr);
+        return false;
+    }
+
+    trace_bdrv_co_preadv_part(bs, offset, bytes, 0);
+
+    bdrv_inc_in_flight(bs);
+    if (!drv->bdrv_aio_preadv_fast(bs, offset, bytes, qiov,
+                                   bdrv_aio_preadv_fast_cb, fr)) {
+        tracked_request_end_fast(&fr->req);
+        bdrv_dec_in_flight(bs);
+        g_free(fr);
+        return false;
+    }
+
+    return true;
+}
+
 static int coroutine_fn GRAPH_RDLOCK
 bdrv_co_do_pwrite_zeroes(BlockDriverState *bs, int64_t offset, int64_t bytes,
                          BdrvRequestFlags flags)
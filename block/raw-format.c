@@ -221,6 +221,17 @@ raw_co_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
     return bdrv_co_preadv(bs->file, offset, bytes, qiov, flags);
 }
 
+static bool GRAPH_RDLOCK
+raw_aio_preadv_fast(BlockDriverState *bs, int64_t offset, int64_t bytes,
+                    QEMUIOVector *qiov, BlockCompletionFunc *cb, void *opaque)
+{
+    if (raw_adjust_offset(bs, &offset, bytes, false)) {
+        return false;
+    }
+
+    return bdrv_aio_preadv_fast(bs->file, offset, bytes, qiov, cb, opaque);
+}
+
 static int coroutine_fn GRAPH_RDLOCK
 raw_co_pwritev(BlockDriverState *bs, int64_t offset, int64_t bytes,
                QEMUIOVector *qiov, BdrvRequestFlags flags)
@@ -647,6 +658,7 @@ BlockDriver bdrv_raw = {
     .bdrv_child_perm      = raw_child_perm,
     .bdrv_co_create_opts  = &raw_co_create_opts,
     .bdrv_co_preadv       = &raw_co_preadv,
+    .bdrv_aio_preadv_fast = &raw_aio_preadv_fast,
     .bdrv_co_pwritev      = &raw_co_pwritev,
     .bdrv_co_pwrite_zeroes = &raw_co_pwrite_zeroes,
     .bdrv_co_pdiscard     = &raw_co_pdiscard,
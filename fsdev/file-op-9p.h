@@ -78,6 +78,10 @@ typedef struct ExtendedOps {
  * Disables certain performance warnings from being logged on host side.
  */
 #define V9FS_NO_PERF_WARN           0x00000800
+/*
+ * Server side metadata caching (cache=loose)
+ */
+#define V9FS_CACHE_LOOSE            0x00001000
 
 #define V9FS_SEC_MASK               0x0000003C
 
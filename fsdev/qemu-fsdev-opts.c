@@ -34,6 +34,9 @@ static QemuOptsList qemu_fsdev_opts = {
         }, {
             .name = "multidevs",
             .type = QEMU_OPT_STRING,
+        }, {
+            .name = "cache",
+            .type = QEMU_OPT_STRING,
         }, {
             .name = "socket",
             .type = QEMU_OPT_STRING,
@@ -80,6 +83,9 @@ static QemuOptsList qemu_virtfs_opts = {
         }, {
             .name = "multidevs",
             .type = QEMU_OPT_STRING,
+        }, {
+            .name = "cache",
+            .type = QEMU_OPT_STRING,
         }, {
             .name = "socket",
             .type = QEMU_OPT_STRING,
@@ -0,0 +1,404 @@
+/*
+ * 9p server side metadata cache
+ *
+ * With cache=loose, the results of lstat() are cached by path name,
+ * including negative (ENOENT) results, so that the guest walking the same
+ * paths over and over again (builds, "git status", ...) doesn't have to go
+ * to the host file system every time.
+ *
+ * Entries are dropped when the path is modified through this export, when
+ * they expire, and, if the host supports it, when inotify reports a change
+ * in their directory. Entries in watched directories live longer than the
+ * others. Changes that neither this export nor inotify sees (e.g. through a
+ * hard link in another directory) can go unnoticed until the entry
+ * expires; this is what makes the cache "loose".
+ *
+ * Only fs drivers with path name based fids (V9FS_PATHNAME_FSCONTEXT) are
+ * supported, as the cache relies on paths being "dir/name" strings.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+/*
+ * Not so fast! You might want to read the 9p developer docs first:
+ * https://wiki.qemu.org/Documentation/9p
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/filemonitor.h"
+#include "qemu/lockable.h"
+#include "qemu/timer.h"
+#include "9p.h"
+#include "9p-cache.h"
+#include "trace.h"
+
+/* Lifetime of entries in directories without an inotify watch */
+#define V9FS_CACHE_TIMEOUT_NS (1 * NANOSECONDS_PER_SECOND)
+/* Lifetime of entries in directories with an inotify watch */
+#define V9FS_CACHE_WATCHED_TIMEOUT_NS (30 * NANOSECONDS_PER_SECOND)
+/* The cache is flushed when it grows beyond this */
+#define V9FS_CACHE_MAX_ENTRIES 65536
+/* No more directories are watched beyond this */
+#define V9FS_CACHE_MAX_WATCHES 4096
+
+typedef struct V9fsCacheEntry {
+    struct stat st;
+    int err;            /* 0, or -ENOENT for a negative entry */
+    int64_t expires;
+} V9fsCacheEntry;
+
+typedef struct V9fsCacheWatch {
+    V9fsCache *cache;
+    char *dir;          /* immutable */
+    int64_t id;         /* -1 until the watch is set up, or if that failed */
+    bool pending;       /* v9fs_cache_watch_dir() hasn't set id yet */
+    bool dead;          /* the directory was removed or renamed */
+} V9fsCacheWatch;
+
+struct V9fsCache {
+    QemuMutex lock;
+    /* path -> V9fsCacheEntry */
+    GHashTable *entries;
+    /* directory path -> V9fsCacheWatch */
+    GHashTable *watches;
+    /* Dead watches, to be removed from the file monitor */
+    GSList *dead_watches;
+    /* Bumped on every invalidation, see v9fs_cache_insert() */
+    uint64_t generation;
+    /* NULL if the host doesn't support file monitoring */
+    QFileMonitor *mon;
+    char *fs_root;
+};
+
+static gboolean path_is_below(gpointer key, gpointer value, gpointer opaque)
+{
+    const char *path = key;
+    const char *dir = opaque;
+    size_t len = strlen(dir);
+
+    return !strncmp(path, dir, len) && path[len] == '/';
+}
+
+/* Called with cache->lock held */
+static void v9fs_cache_drop(V9fsCache *cache, const char *path, bool tree)
+{
+    V9fsCacheEntry *e = g_hash_table_lookup(cache->entries, path);
+    bool is_dir = (e && !e->err && S_ISDIR(e->st.st_mode)) ||
+                  g_hash_table_contains(cache->watches, path);
+
+    cache->generation++;
+    g_hash_table_remove(cache->entries, path);
+
+    if (tree && is_dir) {
+        GHashTableIter iter;
+        gpointer key, value;
+
+        g_hash_table_foreach_remove(cache->entries, path_is_below,
+                                    (gpointer)path);
+
+        /* inotify follows the directory, whose old name is now stale */
+        g_hash_table_iter_init(&iter, cache->watches);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            V9fsCacheWatch *w = value;
+
+            if (!strcmp(key, path) ||
+                path_is_below(key, NULL, (gpointer)path)) {
+                /*
+                 * Make room for a new watch under the same name.  The old
+                 * one can't be removed from the file monitor here, as this
+                 * may run in v9fs_cache_dir_changed().
+                 */
+                w->dead = true;
+                g_hash_table_iter_steal(&iter);
+                cache->dead_watches = g_slist_prepend(cache->dead_watches, w);
+            }
+        }
+    }
+}
+
+static void v9fs_cache_dir_changed(int64_t id, QFileMonitorEvent event,
+                                   const char *filename, void *opaque)
+{
+    V9fsCacheWatch *w = opaque;
+    V9fsCache *cache = w->cache;
+    g_autofree char *path = NULL;
+
+    QEMU_LOCK_GUARD(&cache->lock);
+
+    if (w->dead) {
+        return;
+    }
+
+    trace_v9fs_cache_dir_changed(w->dir, filename, event);
+
+    switch (event) {
+    case QFILE_MONITOR_EVENT_IGNORED:
+        /* The directory itself is gone */
+        v9fs_cache_drop(cache, w->dir, true);
+        w->dead = true;
+        break;
+    case QFILE_MONITOR_EVENT_CREATED:
+    case QFILE_MONITOR_EVENT_DELETED:
+        path = g_strdup_printf("%s/%s", w->dir, filename);
+        v9fs_cache_drop(cache, path, true);
+        /* mtime and link count of the directory changed as well */
+        v9fs_cache_drop(cache, w->dir, false);
+        break;
+    default:
+        path = g_strdup_printf("%s/%s", w->dir, filename);
+        v9fs_cache_drop(cache, path, false);
+        break;
+    }
+}
+
+static void v9fs_cache_watch_free(gpointer data)
+{
+    V9fsCacheWatch *w = data;
+
+    g_free(w->dir);
+    g_free(w);
+}
+
+/*
+ * Remove dead watches from the file monitor and free them.  Watches still
+ * being set up are left for a later call.
+ *
+ * Like v9fs_cache_watch_dir(), this must be called without cache->lock held.
+ */
+static void v9fs_cache_reap_watches(V9fsCache *cache)
+{
+    GSList *reap = NULL;
+    GSList *l, *next;
+
+    WITH_QEMU_LOCK_GUARD(&cache->lock) {
+        for (l = cache->dead_watches; l; l = next) {
+            V9fsCacheWatch *w = l->data;
+
+            next = l->next;
+            if (!w->pending) {
+                cache->dead_watches = g_slist_remove_link(cache->dead_watches,
+                                                          l);
+                reap = g_slist_concat(l, reap);
+            }
+        }
+    }
+
+    for (l = reap; l; l = l->next) {
+        V9fsCacheWatch *w = l->data;
+
+        if (w->id >= 0) {
+            g_autofree char *host_dir =
+                g_build_filename(cache->fs_root, w->dir, NULL);
+
+            /* Waits for a concurrent v9fs_cache_dir_changed() on @w */
+            qemu_file_monitor_remove_watch(cache->mon, host_dir, w->id);
+        }
+        v9fs_cache_watch_free(w);
+    }
+    g_slist_free(reap);
+}
+
+/*
+ * Must be called without cache->lock held: the file monitor runs
+ * v9fs_cache_dir_changed() with its own lock held, so taking the two locks
+ * in the opposite order here could deadlock.
+ */
+static void v9fs_cache_watch_dir(V9fsCache *cache, V9fsCacheWatch *w)
+{
+    g_autofree char *host_dir = NULL;
+    int64_t id;
+
+    /*
+     * A dead watch for the same name would still follow the old directory,
+     * and the file monitor would add the new watch to it.
+     */
+    v9fs_cache_reap_watches(cache);
+
+    host_dir = g_build_filename(cache->fs_root, w->dir, NULL);
+    id = qemu_file_monitor_add_watch(cache->mon, host_dir, NULL,
+                                     v9fs_cache_dir_changed, w, NULL);
+
+    QEMU_LOCK_GUARD(&cache->lock);
+    w->id = id;
+    w->pending = false;
+}
+
+static void v9fs_cache_insert(V9fsCache *cache, const char *path,
+                              const struct stat *st, uint64_t generation)
+{
+    g_autofree char *dir = g_path_get_dirname(path);
+    V9fsCacheWatch *new_watch = NULL;
+    V9fsCacheWatch *w;
+    V9fsCacheEntry *e;
+    bool watched;
+
+    WITH_QEMU_LOCK_GUARD(&cache->lock) {
+        /*
+         * Something was invalidated while we were calling lstat(), which
+         * may or may not have seen the change. Just don't cache the result.
+         */
+        if (cache->generation != generation) {
+            return;
+        }
+
+        if (g_hash_table_size(cache->entries) >= V9FS_CACHE_MAX_ENTRIES) {
+            trace_v9fs_cache_flush(g_hash_table_size(cache->entries));
+            g_hash_table_remove_all(cache->entries);
+        }
+
+        w = g_hash_table_lookup(cache->watches, dir);
+        if (!w && cache->mon &&
+            g_hash_table_size(cache->watches) < V9FS_CACHE_MAX_WATCHES) {
+            new_watch = w = g_new0(V9fsCacheWatch, 1);
+            w->cache = cache;
+            w->dir = g_strdup(dir);
+            w->id = -1;
+            w->pending = true;
+            g_hash_table_insert(cache->watches, w->dir, w);
+        }
+        watched = w && w->id >= 0 && !w->dead;
+
+        e = g_new0(V9fsCacheEntry, 1);
+        if (st) {
+            e->st = *st;
+        } else {
+            e->err = -ENOENT;
+        }
+        e->expires = get_clock() + (watched ? V9FS_CACHE_WATCHED_TIMEOUT_NS
+                                            : V9FS_CACHE_TIMEOUT_NS);
+        g_hash_table_replace(cache->entries, g_strdup(path), e);
+    }
+
+    if (new_watch) {
+        v9fs_cache_watch_dir(cache, new_watch);
+    }
+}
+
+int v9fs_cache_lstat(V9fsState *s, V9fsPath *path, struct stat *stbuf)
+{
+    V9fsCache *cache = s->cache;
+    V9fsCacheEntry *e;
+    uint64_t generation;
+    int err, saved_errno;
+
+    if (!cache) {
+        return s->ops->lstat(&s->ctx, path, stbuf);
+    }
+
+    WITH_QEMU_LOCK_GUARD(&cache->lock) {
+        e = g_hash_table_lookup(cache->entries, path->data);
+        if (e && e->expires > get_clock()) {
+            if (e->err) {
+                errno = -e->err;
+                return -1;
+            }
+            *stbuf = e->st;
+            return 0;
+        }
+        generation = cache->generation;
+    }
+
+    err = s->ops->lstat(&s->ctx, path, stbuf);
+    saved_errno = errno;
+    if (!err || saved_errno == ENOENT) {
+        v9fs_cache_insert(cache, path->data, err ? NULL : stbuf, generation);
+    }
+    errno = saved_errno;
+    return err;
+}
+
+void v9fs_cache_invalidate(V9fsState *s, V9fsPath *path)
+{
+    if (!s->cache) {
+        return;
+    }
+
+    QEMU_LOCK_GUARD(&s->cache->lock);
+    v9fs_cache_drop(s->cache, path->data, false);
+}
+
+void v9fs_cache_invalidate_dentry(V9fsState *s, V9fsPath *path)
+{
+    g_autofree char *dir = NULL;
+
+    if (!s->cache) {
+        return;
+    }
+
+    dir = g_path_get_dirname(path->data);
+
+    QEMU_LOCK_GUARD(&s->cache->lock);
+    v9fs_cache_drop(s->cache, path->data, true);
+    v9fs_cache_drop(s->cache, dir, false);
+}
+
+void v9fs_cache_invalidate_name(V9fsState *s, V9fsPath *dirpath,
+                                const char *name)
+{
+    V9fsPath path;
+
+    if (!s->cache) {
+        return;
+    }
+
+    v9fs_path_init(&path);
+    /* Fails only for names the fs driver refuses, which weren't created */
+    if (!v9fs_name_to_path(s, dirpath, name, &path)) {
+        v9fs_cache_invalidate_dentry(s, &path);
+    }
+    v9fs_path_free(&path);
+}
+
+void v9fs_cache_clear(V9fsState *s)
+{
+    if (!s->cache) {
+        return;
+    }
+
+    QEMU_LOCK_GUARD(&s->cache->lock);
+    s->cache->generation++;
+    g_hash_table_remove_all(s->cache->entries);
+}
+
+void v9fs_cache_init(V9fsState *s)
+{
+    V9fsCache *cache;
+
+    if (!(s->ctx.export_flags & V9FS_CACHE_LOOSE) ||
+        !(s->ctx.export_flags & V9FS_PATHNAME_FSCONTEXT)) {
+        return;
+    }
+
+    cache = g_new0(V9fsCache, 1);
+    qemu_mutex_init(&cache->lock);
+    cache->entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                           g_free, g_free);
+    cache->watches = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                           NULL, v9fs_cache_watch_free);
+    cache->fs_root = g_strdup(s->ctx.fs_root);
+
+    /* Without inotify, entries just expire sooner */
+    cache->mon = qemu_file_monitor_new(NULL);
+
+    s->cache = cache;
+}
+
+void v9fs_cache_cleanup(V9fsState *s)
+{
+    V9fsCache *cache = s->cache;
+
+    if (!cache) {
+        return;
+    }
+
+    /* Removes all watches; no callback can run after this */
+    qemu_file_monitor_free(cache->mon);
+    g_hash_table_destroy(cache->watches);
+    g_slist_free_full(cache->dead_watches, v9fs_cache_watch_free);
+    g_hash_table_destroy(cache->entries);
+    qemu_mutex_destroy(&cache->lock);
+    g_free(cache->fs_root);
+    g_free(cache);
+    s->cache = NULL;
+}
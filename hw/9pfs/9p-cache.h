@@ -0,0 +1,32 @@
+/*
+ * 9p server side metadata cache
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef QEMU_9P_CACHE_H
+#define QEMU_9P_CACHE_H
+
+#include "9p.h"
+
+void v9fs_cache_init(V9fsState *s);
+void v9fs_cache_cleanup(V9fsState *s);
+void v9fs_cache_clear(V9fsState *s);
+
+/*
+ * Same contract as FileOperations.lstat: returns 0, or -1 with errno set.
+ * Falls back to the fs driver if the cache is disabled. Can be called from
+ * any thread.
+ */
+int v9fs_cache_lstat(V9fsState *s, V9fsPath *path, struct stat *stbuf);
+
+/* The attributes of @path have changed */
+void v9fs_cache_invalidate(V9fsState *s, V9fsPath *path);
+/* @path has been created, removed or renamed */
+void v9fs_cache_invalidate_dentry(V9fsState *s, V9fsPath *path);
+/* @name in directory @dirpath has been created, removed or renamed */
+void v9fs_cache_invalidate_name(V9fsState *s, V9fsPath *dirpath,
+                                const char *name);
+
+#endif
@@ -1513,6 +1513,7 @@ static int local_parse_opts(QemuOpts *opts, FsDriverEntry *fse, Error **errp)
     const char *sec_model = qemu_opt_get(opts, "security_model");
     const char *path = qemu_opt_get(opts, "path");
     const char *multidevs = qemu_opt_get(opts, "multidevs");
+    const char *cache = qemu_opt_get(opts, "cache");
 
     if (!sec_model) {
         error_setg(errp, "security_model property not set");
@@ -1557,6 +1558,18 @@ static int local_parse_opts(QemuOpts *opts, FsDriverEntry *fse, Error **errp)
         fse->export_flags |= V9FS_REMAP_INODES;
     }
 
+    if (cache) {
+        if (!strcmp(cache, "loose")) {
+            fse->export_flags |= V9FS_CACHE_LOOSE;
+        } else if (!strcmp(cache, "none")) {
+            fse->export_flags &= ~V9FS_CACHE_LOOSE;
+        } else {
+            error_setg(errp, "invalid cache property '%s'", cache);
+            error_append_hint(errp, "Valid options are: cache=[none|loose]\n");
+            return -1;
+        }
+    }
+
     if (!path) {
         error_setg(errp, "path property not set");
         return -1;
@@ -25,15 +25,18 @@
 #include "qapi/error.h"
 #include "qemu/error-report.h"
 #include "qemu/iov.h"
+#include "qemu/units.h"
 #include "qemu/main-loop.h"
 #include "qemu/sockets.h"
 #include "virtio-9p.h"
 #include "fsdev/qemu-fsdev.h"
 #include "9p-xattr.h"
 #include "9p-util.h"
+#include "9p-cache.h"
 #include "coth.h"
 #include "trace.h"
 #include "migration/blocker.h"
+#include "block/aio_task.h"
 #include "qemu/xxhash.h"
 #include <math.h>
 
@@ -621,6 +624,9 @@ static void coroutine_fn virtfs_reset(V9fsPDU *pdu)
         fidp->clunked = true;
         put_fid(pdu, fidp);
     }
+
+    /* A new client shouldn't trust what the previous one left behind */
+    v9fs_cache_clear(s);
 }
 
 #define P9_QID_TYPE_DIR         0x80
@@ -1910,7 +1916,7 @@ static void coroutine_fn v9fs_walk(void *opaque)
             any_err |= err = -EINTR;
             break;
         }
-        err = s->ops->lstat(&s->ctx, &dpath, &fidst);
+        err = v9fs_cache_lstat(s, &dpath, &fidst);
         if (err < 0) {
             any_err |= err = -errno;
             break;
@@ -1935,7 +1941,7 @@ static void coroutine_fn v9fs_walk(void *opaque)
                     any_err |= err = -EINTR;
                     break;
                 }
-                err = s->ops->lstat(&s->ctx, &pathes[nwalked], &stbuf);
+                err = v9fs_cache_lstat(s, &pathes[nwalked], &stbuf);
                 if (err < 0) {
                     any_err |= err = -errno;
                     break;
@@ -2122,6 +2128,9 @@ static void coroutine_fn v9fs_open(void *opaque)
              */
             fidp->flags |= FID_NON_RECLAIMABLE;
         }
+        if (S_ISREG(stbuf.st_mode)) {
+            fidp->flags |= FID_PARALLEL_IO;
+        }
         iounit = get_iounit(pdu, &fidp->path);
         err = pdu_marshal(pdu, offset, "Qd", &qid, iounit);
         if (err < 0) {
@@ -2193,6 +2202,9 @@ static void coroutine_fn v9fs_lcreate(void *opaque)
          */
         fidp->flags |= FID_NON_RECLAIMABLE;
     }
+    if (S_ISREG(stbuf.st_mode)) {
+        fidp->flags |= FID_PARALLEL_IO;
+    }
     iounit =  get_iounit(pdu, &fidp->path);
     err = stat_to_qid(pdu, &stbuf, &qid);
     if (err < 0) {
@@ -2413,6 +2425,133 @@ static int coroutine_fn v9fs_do_readdir_with_stat(V9fsPDU *pdu,
     return count;
 }
 
+/*
+ * Tread payloads larger than this are split into chunks that worker threads
+ * process in parallel, so that a single request of a client using a large
+ * msize keeps several host I/O requests in flight.  Twrite is not split:
+ * if a chunk in the middle failed, the chunks after it would already have
+ * modified the file although only a short count is reported.
+ */
+#define V9FS_IO_CHUNK_SIZE      (128 * KiB)
+#define V9FS_IO_MAX_CHUNKS      8
+
+/*
+ * Reads or writes the whole of @qiov at @off, looping on EINTR and on short
+ * transfers. Returns the number of bytes transferred, which is only less
+ * than requested at EOF, or -errno.
+ */
+static ssize_t coroutine_fn v9fs_co_rw_full(V9fsPDU *pdu, V9fsFidState *fidp,
+                                            QEMUIOVector *qiov_full,
+                                            uint64_t off, bool is_write)
+{
+    QEMUIOVector qiov;
+    size_t done = 0;
+    int32_t len;
+
+    qemu_iovec_init(&qiov, qiov_full->niov);
+    do {
+        qemu_iovec_reset(&qiov);
+        qemu_iovec_concat(&qiov, qiov_full, done, qiov_full->size - done);
+        if (0) {
+            print_sg(qiov.iov, qiov.niov);
+        }
+        /* Loop in case of EINTR */
+        do {
+            if (is_write) {
+                len = v9fs_co_pwritev(pdu, fidp, qiov.iov, qiov.niov,
+                                      off + done);
+            } else {
+                len = v9fs_co_preadv(pdu, fidp, qiov.iov, qiov.niov,
+                                     off + done);
+            }
+            if (len >= 0) {
+                done += len;
+            }
+        } while (len == -EINTR && !pdu->cancelled);
+    } while (len > 0 && done < qiov_full->size);
+    qemu_iovec_destroy(&qiov);
+
+    /* IO error return the error */
+    return len < 0 ? len : done;
+}
+
+typedef struct V9fsIOTask {
+    AioTask task;
+    V9fsPDU *pdu;
+    V9fsFidState *fidp;
+    QEMUIOVector qiov;
+    uint64_t off;
+    ssize_t *ret;
+} V9fsIOTask;
+
+static int coroutine_fn v9fs_io_task_entry(AioTask *task)
+{
+    V9fsIOTask *t = container_of(task, V9fsIOTask, task);
+
+    *t->ret = v9fs_co_rw_full(t->pdu, t->fidp, &t->qiov, t->off, false);
+    qemu_iovec_destroy(&t->qiov);
+    return 0;
+}
+
+/*
+ * Like v9fs_co_rw_full(), but large reads on fids that allow it are
+ * processed in V9FS_IO_CHUNK_SIZE chunks in parallel. Only the part that
+ * was read contiguously from @off is reported: a short count if a chunk
+ * failed or hit EOF after some data was read, -errno if nothing was.
+ * Writes are always done in order and stop at the first failure.
+ */
+static ssize_t coroutine_fn v9fs_co_rw(V9fsPDU *pdu, V9fsFidState *fidp,
+                                       QEMUIOVector *qiov_full, uint64_t off,
+                                       bool is_write)
+{
+    size_t size = qiov_full->size;
+    unsigned int nchunks = DIV_ROUND_UP(size, V9FS_IO_CHUNK_SIZE);
+    g_autofree ssize_t *rets = NULL;
+    AioTaskPool *pool;
+    size_t done = 0;
+    unsigned int i;
+
+    if (is_write || nchunks < 2 || !(fidp->flags & FID_PARALLEL_IO)) {
+        return v9fs_co_rw_full(pdu, fidp, qiov_full, off, is_write);
+    }
+
+    rets = g_new(ssize_t, nchunks);
+    pool = aio_task_pool_new(V9FS_IO_MAX_CHUNKS);
+    for (i = 0; i < nchunks; i++) {
+        size_t chunk_off = (size_t)i * V9FS_IO_CHUNK_SIZE;
+        V9fsIOTask *t = g_new(V9fsIOTask, 1);
+
+        *t = (V9fsIOTask) {
+            .task.func = v9fs_io_task_entry,
+            .pdu = pdu,
+            .fidp = fidp,
+            .off = off + chunk_off,
+            .ret = &rets[i],
+        };
+        qemu_iovec_init(&t->qiov, qiov_full->niov);
+        qemu_iovec_concat(&t->qiov, qiov_full, chunk_off,
+                          MIN(V9FS_IO_CHUNK_SIZE, size - chunk_off));
+
+        aio_task_pool_wait_slot(pool);
+        aio_task_pool_start_task(pool, &t->task);
+    }
+    aio_task_pool_wait_all(pool);
+    aio_task_pool_free(pool);
+
+    for (i = 0; i < nchunks; i++) {
+        size_t chunk_len = MIN(V9FS_IO_CHUNK_SIZE, size - done);
+
+        if (rets[i] < 0) {
+            return done ? done : rets[i];
+        }
+        done += rets[i];
+        if (rets[i] < chunk_len) {
+            break;
+        }
+    }
+    return done;
+}
+
 static void coroutine_fn v9fs_read(void *opaque)
 {
     int32_t fid;
@@ -2460,38 +2599,21 @@ static void coroutine_fn v9fs_read(void *opaque)
         err += offset + count;
     } else if (fidp->fid_type == P9_FID_FILE) {
         QEMUIOVector qiov_full;
-        QEMUIOVector qiov;
-        int32_t len;
+        ssize_t len;
 
         v9fs_init_qiov_from_pdu(&qiov_full, pdu, offset + 4, max_count, false);
-        qemu_iovec_init(&qiov, qiov_full.niov);
-        do {
-            qemu_iovec_reset(&qiov);
-            qemu_iovec_concat(&qiov, &qiov_full, count, qiov_full.size - count);
-            if (0) {
-                print_sg(qiov.iov, qiov.niov);
-            }
-            /* Loop in case of EINTR */
-            do {
-                len = v9fs_co_preadv(pdu, fidp, qiov.iov, qiov.niov, off);
-                if (len >= 0) {
-                    off   += len;
-                    count += len;
-                }
-            } while (len == -EINTR && !pdu->cancelled);
-            if (len < 0) {
-                /* IO error return the error */
-                err = len;
-                goto out_free_iovec;
-            }
-        } while (count < max_count && len > 0);
+        len = v9fs_co_rw(pdu, fidp, &qiov_full, off, false);
+        if (len < 0) {
+            err = len;
+            goto out_free_iovec;
+        }
+        count = len;
         err = pdu_marshal(pdu, offset, "d", count);
         if (err < 0) {
             goto out_free_iovec;
         }
         err += offset + count;
 out_free_iovec:
-        qemu_iovec_destroy(&qiov);
         qemu_iovec_destroy(&qiov_full);
     } else if (fidp->fid_type == P9_FID_XATTR) {
         err = v9fs_xattr_read(s, pdu, fidp, off, max_count);
@@ -2742,14 +2864,13 @@ static void coroutine_fn v9fs_write(void *opaque)
     int32_t fid;
     uint64_t off;
     uint32_t count;
-    int32_t len = 0;
+    ssize_t len;
     int32_t total = 0;
     size_t offset = 7;
     V9fsFidState *fidp;
     V9fsPDU *pdu = opaque;
     V9fsState *s = pdu->s;
     QEMUIOVector qiov_full;
-    QEMUIOVector qiov;
 
     err = pdu_unmarshal(pdu, offset, "dqd", &fid, &off, &count);
     if (err < 0) {
@@ -2781,37 +2902,20 @@ static void coroutine_fn v9fs_write(void *opaque)
         err = -EINVAL;
         goto out;
     }
-    qemu_iovec_init(&qiov, qiov_full.niov);
-    do {
-        qemu_iovec_reset(&qiov);
-        qemu_iovec_concat(&qiov, &qiov_full, total, qiov_full.size - total);
-        if (0) {
-            print_sg(qiov.iov, qiov.niov);
-        }
-        /* Loop in case of EINTR */
-        do {
-            len = v9fs_co_pwritev(pdu, fidp, qiov.iov, qiov.niov, off);
-            if (len >= 0) {
-                off   += len;
-                total += len;
-            }
-        } while (len == -EINTR && !pdu->cancelled);
-        if (len < 0) {
-            /* IO error return the error */
-            err = len;
-            goto out_qiov;
-        }
-    } while (total < count && len > 0);
+    len = v9fs_co_rw(pdu, fidp, &qiov_full, off, true);
+    if (len < 0) {
+        err = len;
+        goto out;
+    }
+    total = len;
 
     offset = 7;
     err = pdu_marshal(pdu, offset, "d", total);
     if (err < 0) {
-        goto out_qiov;
+        goto out;
     }
     err += offset;
     trace_v9fs_write_return(pdu->tag, pdu->id, total, err);
-out_qiov:
-    qemu_iovec_destroy(&qiov);
 out:
     put_fid(pdu, fidp);
 out_nofid:
@@ -2997,6 +3101,9 @@ static void coroutine_fn v9fs_create(void *opaque)
              */
             fidp->flags |= FID_NON_RECLAIMABLE;
         }
+        if (S_ISREG(stbuf.st_mode)) {
+            fidp->flags |= FID_PARALLEL_IO;
+        }
     }
     iounit = get_iounit(pdu, &fidp->path);
     err = stat_to_qid(pdu, &stbuf, &qid);
@@ -4374,6 +4481,8 @@ int v9fs_device_realize_common(V9fsState *s, const V9fsTransport *t,
 
     s->reclaiming = false;
 
+    v9fs_cache_init(s);
+
     rc = 0;
 out:
     if (rc) {
@@ -4385,6 +4494,7 @@ out:
 
 void v9fs_device_unrealize_common(V9fsState *s)
 {
+    v9fs_cache_cleanup(s);
     if (s->ops && s->ops->cleanup) {
         s->ops->cleanup(&s->ctx);
     }
@@ -117,6 +117,8 @@ typedef enum P9ProtoVersion {
 
 #define FID_REFERENCED          0x1
 #define FID_NON_RECLAIMABLE     0x2
+/* regular file, may be read at several offsets at once */
+#define FID_PARALLEL_IO         0x4
 static inline char *rpath(FsContext *ctx, const char *path)
 {
     return g_strdup_printf("%s/%s", ctx->fs_root, path);
@@ -131,6 +133,7 @@ static inline char *rpath(FsContext *ctx, const char *path)
 typedef struct V9fsPDU V9fsPDU;
 typedef struct V9fsState V9fsState;
 typedef struct V9fsTransport V9fsTransport;
+typedef struct V9fsCache V9fsCache;
 
 typedef struct {
     uint32_t size_le;
@@ -363,6 +366,8 @@ struct V9fsState {
     uint16_t qp_affix_next;
     uint64_t qp_fullpath_next;
     bool reclaiming;
+    /* NULL unless cache=loose */
+    V9fsCache *cache;
 };
 
 /* 9p2000.L open flags */
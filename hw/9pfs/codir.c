@@ -24,6 +24,7 @@
 #include "coth.h"
 #include "9p-xattr.h"
 #include "9p-util.h"
+#include "9p-cache.h"
 
 /*
  * Intended to be called from bottom-half (e.g. background I/O thread)
@@ -157,7 +158,7 @@ do_readdir_many(V9fsPDU *pdu, V9fsFidState *fidp, struct V9fsDirEnt **entries,
                 break;
             }
 
-            err = s->ops->lstat(&s->ctx, &path, &stbuf);
+            err = v9fs_cache_lstat(s, &path, &stbuf);
             if (err < 0) {
                 err = -errno;
                 break;
@@ -299,6 +300,7 @@ int coroutine_fn v9fs_co_mkdir(V9fsPDU *pdu, V9fsFidState *fidp,
                 v9fs_path_init(&path);
                 err = v9fs_name_to_path(s, &fidp->path, name->data, &path);
                 if (!err) {
+                    v9fs_cache_invalidate_dentry(s, &path);
                     err = s->ops->lstat(&s->ctx, &path, stbuf);
                     if (err < 0) {
                         err = -errno;
@@ -22,6 +22,7 @@
 #include "qemu/main-loop.h"
 #include "qemu/error-report.h"
 #include "coth.h"
+#include "9p-cache.h"
 
 int coroutine_fn v9fs_co_st_gen(V9fsPDU *pdu, V9fsPath *path, mode_t st_mode,
                                 V9fsStatDotl *v9stat)
@@ -58,7 +59,7 @@ int coroutine_fn v9fs_co_lstat(V9fsPDU *pdu, V9fsPath *path, struct stat *stbuf)
     v9fs_path_read_lock(s);
     v9fs_co_run_in_worker(
         {
-            err = s->ops->lstat(&s->ctx, path, stbuf);
+            err = v9fs_cache_lstat(s, path, stbuf);
             if (err < 0) {
                 err = -errno;
             }
@@ -116,6 +117,9 @@ int coroutine_fn v9fs_co_open(V9fsPDU *pdu, V9fsFidState *fidp, int flags)
                 err = -errno;
             } else {
                 err = 0;
+                if (flags & O_TRUNC) {
+                    v9fs_cache_invalidate(s, &fidp->path);
+                }
             }
         });
     v9fs_path_unlock(s);
@@ -160,6 +164,7 @@ int coroutine_fn v9fs_co_open2(V9fsPDU *pdu, V9fsFidState *fidp,
                 v9fs_path_init(&path);
                 err = v9fs_name_to_path(s, &fidp->path, name->data, &path);
                 if (!err) {
+                    v9fs_cache_invalidate_dentry(s, &path);
                     err = s->ops->lstat(&s->ctx, &path, stbuf);
                     if (err < 0) {
                         err = -errno;
@@ -242,6 +247,10 @@ int coroutine_fn v9fs_co_link(V9fsPDU *pdu, V9fsFidState *oldfid,
                                &newdirfid->path, name->data);
             if (err < 0) {
                 err = -errno;
+            } else {
+                /* link count and ctime of the old name change too */
+                v9fs_cache_invalidate(s, &oldfid->path);
+                v9fs_cache_invalidate_name(s, &newdirfid->path, name->data);
             }
         });
     v9fs_path_unlock(s);
@@ -265,6 +274,10 @@ int coroutine_fn v9fs_co_pwritev(V9fsPDU *pdu, V9fsFidState *fidp,
                 err = -errno;
             }
         });
+    /* fid paths are only updated in coroutine context */
+    if (err > 0) {
+        v9fs_cache_invalidate(s, &fidp->path);
+    }
     return err;
 }
 
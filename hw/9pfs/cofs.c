@@ -21,6 +21,7 @@
 #include "qemu/thread.h"
 #include "qemu/main-loop.h"
 #include "coth.h"
+#include "9p-cache.h"
 
 static ssize_t __readlink(V9fsState *s, V9fsPath *path, V9fsString *buf)
 {
@@ -112,6 +113,8 @@ int coroutine_fn v9fs_co_chmod(V9fsPDU *pdu, V9fsPath *path, mode_t mode)
             err = s->ops->chmod(&s->ctx, path, &cred);
             if (err < 0) {
                 err = -errno;
+            } else {
+                v9fs_cache_invalidate(s, path);
             }
         });
     v9fs_path_unlock(s);
@@ -133,6 +136,8 @@ int coroutine_fn v9fs_co_utimensat(V9fsPDU *pdu, V9fsPath *path,
             err = s->ops->utimensat(&s->ctx, path, times);
             if (err < 0) {
                 err = -errno;
+            } else {
+                v9fs_cache_invalidate(s, path);
             }
         });
     v9fs_path_unlock(s);
@@ -155,6 +160,10 @@ int coroutine_fn v9fs_co_futimens(V9fsPDU *pdu, V9fsFidState *fidp,
                 err = -errno;
             }
         });
+    /* fid paths are only updated in coroutine context */
+    if (!err) {
+        v9fs_cache_invalidate(s, &fidp->path);
+    }
     return err;
 }
 
@@ -177,6 +186,8 @@ int coroutine_fn v9fs_co_chown(V9fsPDU *pdu, V9fsPath *path, uid_t uid,
             err = s->ops->chown(&s->ctx, path, &cred);
             if (err < 0) {
                 err = -errno;
+            } else {
+                v9fs_cache_invalidate(s, path);
             }
         });
     v9fs_path_unlock(s);
@@ -197,6 +208,8 @@ int coroutine_fn v9fs_co_truncate(V9fsPDU *pdu, V9fsPath *path, off_t size)
             err = s->ops->truncate(&s->ctx, path, size);
             if (err < 0) {
                 err = -errno;
+            } else {
+                v9fs_cache_invalidate(s, path);
             }
         });
     v9fs_path_unlock(s);
@@ -218,6 +231,10 @@ int coroutine_fn v9fs_co_ftruncate(V9fsPDU *pdu, V9fsFidState *fidp, off_t size)
                 err = -errno;
             }
         });
+    /* fid paths are only updated in coroutine context */
+    if (!err) {
+        v9fs_cache_invalidate(s, &fidp->path);
+    }
     return err;
 }
 
@@ -248,6 +265,7 @@ int coroutine_fn v9fs_co_mknod(V9fsPDU *pdu, V9fsFidState *fidp,
                 v9fs_path_init(&path);
                 err = v9fs_name_to_path(s, &fidp->path, name->data, &path);
                 if (!err) {
+                    v9fs_cache_invalidate_dentry(s, &path);
                     err = s->ops->lstat(&s->ctx, &path, stbuf);
                     if (err < 0) {
                         err = -errno;
@@ -275,6 +293,8 @@ int coroutine_fn v9fs_co_remove(V9fsPDU *pdu, V9fsPath *path)
             err = s->ops->remove(&s->ctx, path->data);
             if (err < 0) {
                 err = -errno;
+            } else {
+                v9fs_cache_invalidate_dentry(s, path);
             }
         });
     v9fs_path_unlock(s);
@@ -296,6 +316,8 @@ int coroutine_fn v9fs_co_unlinkat(V9fsPDU *pdu, V9fsPath *path,
             err = s->ops->unlinkat(&s->ctx, path, name->data, flags);
             if (err < 0) {
                 err = -errno;
+            } else {
+                v9fs_cache_invalidate_name(s, path, name->data);
             }
         });
     v9fs_path_unlock(s);
@@ -317,6 +339,9 @@ int coroutine_fn v9fs_co_rename(V9fsPDU *pdu, V9fsPath *oldpath,
             err = s->ops->rename(&s->ctx, oldpath->data, newpath->data);
             if (err < 0) {
                 err = -errno;
+            } else {
+                v9fs_cache_invalidate_dentry(s, oldpath);
+                v9fs_cache_invalidate_dentry(s, newpath);
             }
         });
     return err;
@@ -338,6 +363,9 @@ int coroutine_fn v9fs_co_renameat(V9fsPDU *pdu, V9fsPath *olddirpath,
                                    newdirpath, newname->data);
             if (err < 0) {
                 err = -errno;
+            } else {
+                v9fs_cache_invalidate_name(s, olddirpath, oldname->data);
+                v9fs_cache_invalidate_name(s, newdirpath, newname->data);
             }
         });
     return err;
@@ -370,6 +398,7 @@ int coroutine_fn v9fs_co_symlink(V9fsPDU *pdu, V9fsFidState *dfidp,
                 v9fs_path_init(&path);
                 err = v9fs_name_to_path(s, &dfidp->path, name->data, &path);
                 if (!err) {
+                    v9fs_cache_invalidate_dentry(s, &path);
                     err = s->ops->lstat(&s->ctx, &path, stbuf);
                     if (err < 0) {
                         err = -errno;
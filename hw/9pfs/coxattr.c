@@ -21,6 +21,7 @@
 #include "qemu/thread.h"
 #include "qemu/main-loop.h"
 #include "coth.h"
+#include "9p-cache.h"
 
 int coroutine_fn v9fs_co_llistxattr(V9fsPDU *pdu, V9fsPath *path, void *value,
                                     size_t size)
@@ -85,6 +86,8 @@ int coroutine_fn v9fs_co_lsetxattr(V9fsPDU *pdu, V9fsPath *path,
                                     size, flags);
             if (err < 0) {
                 err = -errno;
+            } else {
+                v9fs_cache_invalidate(s, path);
             }
         });
     v9fs_path_unlock(s);
@@ -106,6 +109,8 @@ int coroutine_fn v9fs_co_lremovexattr(V9fsPDU *pdu, V9fsPath *path,
             err = s->ops->lremovexattr(&s->ctx, path, xattr_name->data);
             if (err < 0) {
                 err = -errno;
+            } else {
+                v9fs_cache_invalidate(s, path);
             }
         });
     v9fs_path_unlock(s);
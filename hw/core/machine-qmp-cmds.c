@@ -162,6 +162,11 @@ CurrentMachineParams *qmp_query_current_machine(Error **errp)
     return params;
 }
 
+StartupTimeline *qmp_query_startup_timeline(Error **errp)
+{
+    return phase_get_startup_timeline();
+}
+
 QemuTargetInfo *qmp_query_target(Error **errp)
 {
     QemuTargetInfo *info = g_malloc0(sizeof(*info));
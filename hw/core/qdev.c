@@ -32,6 +32,7 @@
 #include "qapi/visitor.h"
 #include "qemu/error-report.h"
 #include "qemu/option.h"
+#include "qemu/timer.h"
 #include "hw/core/irq.h"
 #include "hw/core/qdev-properties.h"
 #include "hw/core/boards.h"
@@ -480,6 +481,9 @@ static bool check_only_migratable(Object *obj, Error **errp)
     return true;
 }
 
+static void phase_record_realize(DeviceState *dev, int64_t start,
+                                 int64_t duration);
+
 static void device_set_realized(Object *obj, bool value, Error **errp)
 {
     DeviceState *dev = DEVICE(obj);
@@ -520,10 +524,18 @@ static void device_set_realized(Object *obj, bool value, Error **errp)
         }
 
         if (dc->realize) {
+            /* Only cold-plugged devices go into the startup timeline */
+            bool timed = phase_check(PHASE_MACHINE_CREATED) &&
+                         !phase_check(PHASE_MACHINE_READY);
+            int64_t start = timed ? get_clock() : 0;
+
             dc->realize(dev, &local_err);
             if (local_err != NULL) {
                 goto fail;
             }
+            if (timed) {
+                phase_record_realize(dev, start, get_clock() - start);
+            }
         }
 
         DEVICE_LISTENER_CALL(realize, Forward, dev);
@@ -876,6 +888,26 @@ char *qdev_get_human_name(DeviceState *dev)
 }
 
 static MachineInitPhase machine_phase;
+static int64_t machine_phase_start[PHASE_MACHINE_READY + 1];
+
+typedef struct DeviceRealizeTime {
+    char *qom_path;
+    const char *type;
+    int64_t start;
+    int64_t duration;
+} DeviceRealizeTime;
+
+static GArray *device_realize_times;
+
+static const StartupPhase startup_phase_map[] = {
+    [PHASE_NO_MACHINE] = STARTUP_PHASE_NO_MACHINE,
+    [PHASE_MACHINE_CREATED] = STARTUP_PHASE_MACHINE_CREATED,
+    [PHASE_ACCEL_CREATED] = STARTUP_PHASE_ACCEL_CREATED,
+    [PHASE_LATE_BACKENDS_CREATED] = STARTUP_PHASE_LATE_BACKENDS_CREATED,
+    [PHASE_MACHINE_INITIALIZED] = STARTUP_PHASE_MACHINE_INITIALIZED,
+    [PHASE_MACHINE_READY] = STARTUP_PHASE_MACHINE_READY,
+};
+QEMU_BUILD_BUG_ON(ARRAY_SIZE(startup_phase_map) != STARTUP_PHASE__MAX);
 
 bool phase_check(MachineInitPhase phase)
 {
@@ -886,6 +918,66 @@ void phase_advance(MachineInitPhase phase)
 {
     assert(machine_phase == phase - 1);
     machine_phase = phase;
+    machine_phase_start[phase] = get_clock();
+}
+
+void phase_timeline_init(void)
+{
+    assert(machine_phase == PHASE_NO_MACHINE);
+    machine_phase_start[PHASE_NO_MACHINE] = get_clock();
+}
+
+static void phase_record_realize(DeviceState *dev, int64_t start,
+                                 int64_t duration)
+{
+    DeviceRealizeTime t = {
+        .qom_path = object_get_canonical_path(OBJECT(dev)),
+        .type = object_get_typename(OBJECT(dev)),
+        .start = start,
+        .duration = duration,
+    };
+
+    if (!device_realize_times) {
+        device_realize_times = g_array_new(false, false, sizeof(t));
+    }
+    g_array_append_val(device_realize_times, t);
+}
+
+StartupTimeline *phase_get_startup_timeline(void)
+{
+    StartupTimeline *timeline = g_new0(StartupTimeline, 1);
+    StartupPhaseInfoList **phase_tail = &timeline->phases;
+    StartupDeviceInfoList **dev_tail = &timeline->devices;
+    int64_t origin = machine_phase_start[PHASE_NO_MACHINE];
+    MachineInitPhase phase;
+    guint i;
+
+    for (phase = PHASE_NO_MACHINE; phase <= machine_phase; phase++) {
+        StartupPhaseInfo *info = g_new0(StartupPhaseInfo, 1);
+
+        info->phase = startup_phase_map[phase];
+        info->start_ns = machine_phase_start[phase] - origin;
+        if (phase < machine_phase) {
+            info->has_duration_ns = true;
+            info->duration_ns = machine_phase_start[phase + 1] -
+                                machine_phase_start[phase];
+        }
+        QAPI_LIST_APPEND(phase_tail, info);
+    }
+
+    for (i = 0; device_realize_times && i < device_realize_times->len; i++) {
+        DeviceRealizeTime *t = &g_array_index(device_realize_times,
+                                              DeviceRealizeTime, i);
+        StartupDeviceInfo *info = g_new0(StartupDeviceInfo, 1);
+
+        info->qom_path = g_strdup(t->qom_path);
+        info->type = g_strdup(t->type);
+        info->start_ns = t->start - origin;
+        info->realize_ns = t->duration;
+        QAPI_LIST_APPEND(dev_tail, info);
+    }
+
+    return timeline;
 }
 
 static const TypeInfo device_type_info = {
@@ -1973,7 +1973,7 @@ static ssize_t virtio_net_receive_rcu(NetClientState *nc, const uint8_t *buf,
             virtio_error(vdev,
                          "virtio-net receive queue contains no in buffers");
             virtqueue_detach_element(q->rx_vq, elem, 0);
-            g_free(elem);
+            virtqueue_element_release(q->rx_vq, elem);
             err = -1;
             goto err;
         }
@@ -2016,7 +2016,7 @@ static ssize_t virtio_net_receive_rcu(NetClientState *nc, const uint8_t *buf,
          * Otherwise, drop it. */
         if (!n->mergeable_rx_bufs && offset < size) {
             virtqueue_unpop(q->rx_vq, elem, total);
-            g_free(elem);
+            virtqueue_element_release(q->rx_vq, elem);
             err = size;
             goto err;
         }
@@ -2037,7 +2037,7 @@ static ssize_t virtio_net_receive_rcu(NetClientState *nc, const uint8_t *buf,
     for (j = 0; j < i; j++) {
         /* signal other side */
         virtqueue_fill(q->rx_vq, elems[j], lens[j], j);
-        g_free(elems[j]);
+        virtqueue_element_release(q->rx_vq, elems[j]);
     }
 
     virtqueue_flush(q->rx_vq, i);
@@ -2048,7 +2048,7 @@ static ssize_t virtio_net_receive_rcu(NetClientState *nc, const uint8_t *buf,
 err:
     for (j = 0; j < i; j++) {
         virtqueue_detach_element(q->rx_vq, elems[j], lens[j]);
-        g_free(elems[j]);
+        virtqueue_element_release(q->rx_vq, elems[j]);
     }
 
     return err;
@@ -2693,7 +2693,7 @@ static void virtio_net_tx_complete(NetClientState *nc, ssize_t len)
     virtqueue_push(q->tx_vq, q->async_tx.elem, 0);
     virtio_notify(vdev, q->tx_vq);
 
-    g_free(q->async_tx.elem);
+    virtqueue_element_release(q->tx_vq, q->async_tx.elem);
     q->async_tx.elem = NULL;
 
     virtio_queue_set_notification(q->tx_vq, 1);
@@ -2804,7 +2804,7 @@ static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
 drop:
         virtqueue_push(q->tx_vq, elem, 0);
         virtio_notify(vdev, q->tx_vq);
-        g_free(elem);
+        virtqueue_element_release(q->tx_vq, elem);
 
         if (++num_packets >= n->tx_burst) {
             break;
@@ -2814,7 +2814,7 @@ drop:
 
 detach:
     virtqueue_detach_element(q->tx_vq, elem, 0);
-    g_free(elem);
+    virtqueue_element_release(q->tx_vq, elem);
     return -EINVAL;
 }
 
@@ -21,6 +21,7 @@
 #include "qemu/main-loop.h"
 #include "qemu/module.h"
 #include "qemu/target-info.h"
+#include "qemu/thread.h"
 #include "qom/object_interfaces.h"
 #include "hw/core/cpu.h"
 #include "hw/virtio/virtio.h"
@@ -61,6 +62,9 @@
  */
 #define VIRTIO_PCI_VRING_ALIGN         4096
 
+/* Released elements kept around per virtqueue for reuse by the next pops */
+#define VIRTQUEUE_ELEM_POOL_SIZE       64
+
 typedef struct VRingDesc
 {
     uint64_t addr;
@@ -155,6 +159,14 @@ struct VirtQueue
     EventNotifier host_notifier;
     bool host_notifier_enabled;
     QLIST_ENTRY(VirtQueue) node;
+
+    /*
+     * Elements returned with virtqueue_element_release(), recycled by the
+     * next pops on this queue instead of going back to the allocator.
+     */
+    QemuSpin elem_pool_lock;
+    unsigned int elem_pool_len;
+    VirtQueueElement *elem_pool[VIRTQUEUE_ELEM_POOL_SIZE];
 };
 
 const char *virtio_device_names[] = {
@@ -1700,7 +1712,62 @@ void virtqueue_map(VirtIODevice *vdev, VirtQueueElement *elem)
                                                                         false);
 }
 
-static void *virtqueue_alloc_element(size_t sz, unsigned out_num, unsigned in_num)
+/*
+ * Size of the allocation backing @elem.  The scatter-gather arrays are laid
+ * out after the device struct by virtqueue_alloc_element(), with out_sg last.
+ */
+static size_t virtqueue_element_size(const VirtQueueElement *elem)
+{
+    return (void *)(elem->out_sg + elem->out_num) - (void *)elem;
+}
+
+static VirtQueueElement *virtqueue_elem_pool_get(VirtQueue *vq, size_t size)
+{
+    VirtQueueElement *elem = NULL;
+    unsigned int i;
+
+    if (!vq || !qatomic_read(&vq->elem_pool_len)) {
+        return NULL;
+    }
+
+    qemu_spin_lock(&vq->elem_pool_lock);
+    for (i = vq->elem_pool_len; i-- > 0;) {
+        if (virtqueue_element_size(vq->elem_pool[i]) >= size) {
+            elem = vq->elem_pool[i];
+            vq->elem_pool[i] = vq->elem_pool[--vq->elem_pool_len];
+            break;
+        }
+    }
+    qemu_spin_unlock(&vq->elem_pool_lock);
+    return elem;
+}
+
+static void virtqueue_elem_pool_drain(VirtQueue *vq)
+{
+    qemu_spin_lock(&vq->elem_pool_lock);
+    while (vq->elem_pool_len) {
+        g_free(vq->elem_pool[--vq->elem_pool_len]);
+    }
+    qemu_spin_unlock(&vq->elem_pool_lock);
+}
+
+void virtqueue_element_release(VirtQueue *vq, void *opaque)
+{
+    VirtQueueElement *elem = opaque;
+
+    if (vq->vring.num) {
+        qemu_spin_lock(&vq->elem_pool_lock);
+        if (vq->elem_pool_len < VIRTQUEUE_ELEM_POOL_SIZE) {
+            vq->elem_pool[vq->elem_pool_len++] = elem;
+            elem = NULL;
+        }
+        qemu_spin_unlock(&vq->elem_pool_lock);
+    }
+    g_free(elem);
+}
+
+static void *virtqueue_alloc_element(VirtQueue *vq, size_t sz,
+                                     unsigned out_num, unsigned in_num)
 {
     VirtQueueElement *elem;
     size_t in_addr_ofs = QEMU_ALIGN_UP(sz, __alignof__(elem->in_addr[0]));
@@ -1711,7 +1778,10 @@ static void *virtqueue_alloc_element(size_t sz, unsigned out_num, unsigned in_nu
     size_t out_sg_end = out_sg_ofs + out_num * sizeof(elem->out_sg[0]);
 
     assert(sz >= sizeof(VirtQueueElement));
-    elem = g_malloc(out_sg_end);
+    elem = virtqueue_elem_pool_get(vq, out_sg_end);
+    if (!elem) {
+        elem = g_malloc(out_sg_end);
+    }
     trace_virtqueue_alloc_element(elem, sz, in_num, out_num);
     elem->out_num = out_num;
     elem->in_num = in_num;
@@ -1722,7 +1792,12 @@ static void *virtqueue_alloc_element(size_t sz, unsigned out_num, unsigned in_nu
     return elem;
 }
 
-static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
+/*
+ * Pop the element at vq->last_avail_idx, which the caller has checked to be
+ * available.  Called within rcu_read_lock().
+ */
+static void *virtqueue_split_pop_rcu(VirtQueue *vq, size_t sz,
+                                     bool set_avail_event)
 {
     unsigned int i, head, max, idx;
     VRingMemoryRegionCaches *caches;
@@ -1739,14 +1814,6 @@ static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
 
     address_space_cache_init_empty(&indirect_desc_cache);
 
-    RCU_READ_LOCK_GUARD();
-    if (virtio_queue_empty_rcu(vq)) {
-        goto done;
-    }
-    /* Needed after virtio_queue_empty(), see comment in
-     * virtqueue_num_heads(). */
-    smp_rmb();
-
     /* When we start there are none of either input nor output. */
     out_num = in_num = elem_entries = 0;
 
@@ -1761,7 +1828,8 @@ static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
         goto done;
     }
 
-    if (virtio_vdev_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX)) {
+    if (set_avail_event &&
+        virtio_vdev_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX)) {
         vring_set_avail_event(vq, vq->last_avail_idx);
     }
 
@@ -1837,7 +1905,7 @@ static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
     }
 
     /* Now copy what we have collected and mapped */
-    elem = virtqueue_alloc_element(sz, out_num, in_num);
+    elem = virtqueue_alloc_element(vq, sz, out_num, in_num);
     elem->index = head;
     elem->ndescs = 1;
     for (i = 0; i < out_num; i++) {
@@ -1869,6 +1937,53 @@ err_undo_map:
     goto done;
 }
 
+static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
+{
+    RCU_READ_LOCK_GUARD();
+    if (virtio_queue_empty_rcu(vq)) {
+        return NULL;
+    }
+    /* Needed after virtio_queue_empty(), see comment in
+     * virtqueue_num_heads(). */
+    smp_rmb();
+
+    return virtqueue_split_pop_rcu(vq, sz, true);
+}
+
+static unsigned int virtqueue_split_pop_batch(VirtQueue *vq, size_t sz,
+                                              void **elems, unsigned int max)
+{
+    unsigned int i, n;
+    int num_heads;
+
+    RCU_READ_LOCK_GUARD();
+    if (unlikely(!vq->vring.avail)) {
+        return 0;
+    }
+
+    /*
+     * Read the avail index once for the whole batch; virtqueue_num_heads()
+     * provides the barrier ordering it before the descriptor reads.
+     */
+    num_heads = virtqueue_num_heads(vq, vq->last_avail_idx);
+    if (num_heads <= 0) {
+        return 0;
+    }
+
+    n = MIN(max, num_heads);
+    for (i = 0; i < n; i++) {
+        elems[i] = virtqueue_split_pop_rcu(vq, sz, false);
+        if (!elems[i]) {
+            break;
+        }
+    }
+
+    if (i && virtio_vdev_has_feature(vq->vdev, VIRTIO_RING_F_EVENT_IDX)) {
+        vring_set_avail_event(vq, vq->last_avail_idx);
+    }
+    return i;
+}
+
 static void *virtqueue_packed_pop(VirtQueue *vq, size_t sz)
 {
     unsigned int i, max;
@@ -1978,7 +2093,7 @@ static void *virtqueue_packed_pop(VirtQueue *vq, size_t sz)
     }
 
     /* Now copy what we have collected and mapped */
-    elem = virtqueue_alloc_element(sz, out_num, in_num);
+    elem = virtqueue_alloc_element(vq, sz, out_num, in_num);
     for (i = 0; i < out_num; i++) {
         elem->out_addr[i] = addr[i];
         elem->out_sg[i] = iov[i];
@@ -2032,6 +2147,29 @@ void *virtqueue_pop(VirtQueue *vq, size_t sz)
     }
 }
 
+unsigned int virtqueue_pop_batch(VirtQueue *vq, size_t sz, void **elems,
+                                 unsigned int max)
+{
+    unsigned int i;
+
+    if (virtio_device_disabled(vq->vdev)) {
+        return 0;
+    }
+
+    if (virtio_vdev_has_feature(vq->vdev, VIRTIO_F_RING_PACKED)) {
+        /* Availability is per descriptor here, there is no index to batch */
+        for (i = 0; i < max; i++) {
+            elems[i] = virtqueue_packed_pop(vq, sz);
+            if (!elems[i]) {
+                break;
+            }
+        }
+        return i;
+    }
+
+    return virtqueue_split_pop_batch(vq, sz, elems, max);
+}
+
 static unsigned int virtqueue_packed_drop_all(VirtQueue *vq)
 {
     VRingMemoryRegionCaches *caches;
@@ -2167,7 +2305,7 @@ void *qemu_get_virtqueue_element(VirtIODevice *vdev, QEMUFile *f, size_t sz)
     assert(ARRAY_SIZE(data.in_addr) >= data.in_num);
     assert(ARRAY_SIZE(data.out_addr) >= data.out_num);
 
-    elem = virtqueue_alloc_element(sz, data.out_num, data.in_num);
+    elem = virtqueue_alloc_element(NULL, sz, data.out_num, data.in_num);
     elem->index = data.index;
 
     for (i = 0; i < elem->in_num; i++) {
@@ -2565,6 +2703,7 @@ VirtQueue *virtio_add_queue(VirtIODevice *vdev, int queue_size,
     vdev->vq[i].vring.align = VIRTIO_PCI_VRING_ALIGN;
     vdev->vq[i].handle_output = handle_output;
     vdev->vq[i].used_elems = g_new0(VirtQueueElement, queue_size);
+    qemu_spin_init(&vdev->vq[i].elem_pool_lock);
 
     return &vdev->vq[i];
 }
@@ -2576,6 +2715,7 @@ void virtio_delete_queue(VirtQueue *vq)
     vq->handle_output = NULL;
     g_free(vq->used_elems);
     vq->used_elems = NULL;
+    virtqueue_elem_pool_drain(vq);
     virtio_virtqueue_reset_region_cache(vq);
 }
 
@@ -4102,6 +4242,7 @@ static void virtio_device_free_virtqueues(VirtIODevice *vdev)
         if (vdev->vq[i].vring.num == 0) {
             break;
         }
+        virtqueue_elem_pool_drain(&vdev->vq[i]);
         virtio_virtqueue_reset_region_cache(&vdev->vq[i]);
     }
     g_free(vdev->vq);
@@ -521,6 +521,20 @@ struct BlockDriver {
         int64_t offset, int64_t bytes, QEMUIOVector *qiov,
         BdrvRequestFlags flags, BlockCompletionFunc *cb, void *opaque);
 
+    /*
+     * Optional: start a read outside of coroutine context, for
+     * bdrv_aio_preadv_fast().  Only called for requests without flags that
+     * are aligned to request_alignment and lie within the image.  Returns
+     * false without calling @cb if the request has to go through the
+     * coroutine path instead.
+     *
+     * BlockBackends only try the fast path if the driver of their root
+     * node implements this.
+     */
+    bool GRAPH_RDLOCK_PTR (*bdrv_aio_preadv_fast)(BlockDriverState *bs,
+        int64_t offset, int64_t bytes, QEMUIOVector *qiov,
+        BlockCompletionFunc *cb, void *opaque);
+
     BlockAIOCB * GRAPH_RDLOCK_PTR (*bdrv_aio_flush)(
         BlockDriverState *bs, BlockCompletionFunc *cb, void *opaque);
 
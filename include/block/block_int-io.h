@@ -113,6 +113,10 @@ void bdrv_dirty_bitmap_merge_internal(BdrvDirtyBitmap *dest,
 void bdrv_inc_in_flight(BlockDriverState *bs);
 void bdrv_dec_in_flight(BlockDriverState *bs);
 
+bool no_coroutine_fn GRAPH_RDLOCK
+bdrv_aio_preadv_fast(BdrvChild *child, int64_t offset, int64_t bytes,
+                     QEMUIOVector *qiov, BlockCompletionFunc *cb, void *opaque);
+
 int coroutine_fn GRAPH_RDLOCK
 bdrv_co_copy_range_from(BdrvChild *src, int64_t src_offset,
                         BdrvChild *dst, int64_t dst_offset,
@@ -32,6 +32,12 @@ typedef struct BlockExportDriver {
     /* True if the export type supports running on an inactive node */
     bool supports_inactive;
 
+    /*
+     * True if the export type can distribute its I/O across multiple
+     * AioContexts (BlockExport.multithread_ctxs)
+     */
+    bool supports_multithread;
+
     /* Creates and starts a new block export */
     int (*create)(BlockExport *, BlockExportOptions *, Error **);
 
@@ -79,6 +85,14 @@ struct BlockExport {
     /* The block device to export */
     BlockBackend *blk;
 
+    /*
+     * If the user requested multi-threading, the AioContexts of all
+     * iothreads the export may run I/O in, in the order given by the user.
+     * NULL and 0 otherwise. Immutable after creation.
+     */
+    AioContext **multithread_ctxs;
+    size_t multithread_count;
+
     /* List entry for block_exports */
     QLIST_ENTRY(BlockExport) next;
 };
@@ -165,6 +165,22 @@ bdrv_graph_co_rdlock(void);
 void coroutine_fn TSA_RELEASE_SHARED(graph_lock) TSA_NO_TSA
 bdrv_graph_co_rdunlock(void);
 
+/*
+ * bdrv_graph_rdlock_try:
+ * Non-blocking variant of bdrv_graph_co_rdlock() for callers outside of
+ * coroutine context that keep the lock across an asynchronous request.
+ * Returns false without taking the lock if a writer is active or the
+ * current thread has no AioContext; the caller must then go through a
+ * coroutine instead.
+ *
+ * The lock must be dropped with bdrv_graph_rdunlock_nocoroutine() in the
+ * same AioContext.
+ */
+bool no_coroutine_fn TSA_NO_TSA bdrv_graph_rdlock_try(void);
+
+void no_coroutine_fn TSA_RELEASE_SHARED(graph_lock) TSA_NO_TSA
+bdrv_graph_rdunlock_nocoroutine(void);
+
 /*
  * bdrv_graph_rd{un}lock_main_loop:
  * Just a placeholder to mark where the graph rdlock should be taken
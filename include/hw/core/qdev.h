@@ -1157,4 +1157,20 @@ typedef enum MachineInitPhase {
 bool phase_check(MachineInitPhase phase);
 void phase_advance(MachineInitPhase phase);
 
+/**
+ * phase_timeline_init() - start timing machine initialization
+ *
+ * Record the start of %PHASE_NO_MACHINE, which the times reported by
+ * phase_get_startup_timeline() are relative to.
+ */
+void phase_timeline_init(void);
+
+/**
+ * phase_get_startup_timeline() - get the startup timeline
+ *
+ * Return: the time spent in each phase so far and in realizing each
+ * cold-plugged device, for query-startup-timeline.
+ */
+struct StartupTimeline *phase_get_startup_timeline(void);
+
 #endif
@@ -280,6 +280,30 @@ void virtqueue_fill(VirtQueue *vq, const VirtQueueElement *elem,
 
 void virtqueue_map(VirtIODevice *vdev, VirtQueueElement *elem);
 void *virtqueue_pop(VirtQueue *vq, size_t sz);
+/**
+ * virtqueue_pop_batch() - pop several elements at once
+ * @vq: the virtqueue
+ * @sz: size of the device struct embedding VirtQueueElement, as for
+ *      virtqueue_pop()
+ * @elems: array receiving up to @max elements
+ * @max: size of @elems
+ *
+ * Pop up to @max elements, reading the avail index only once for the whole
+ * batch.
+ *
+ * Returns: the number of elements stored in @elems.
+ */
+unsigned int virtqueue_pop_batch(VirtQueue *vq, size_t sz, void **elems,
+                                 unsigned int max);
+/**
+ * virtqueue_element_release() - free a popped element
+ * @vq: the virtqueue @elem was popped from
+ * @elem: element returned by virtqueue_pop() or virtqueue_pop_batch()
+ *
+ * Free @elem, keeping its memory for reuse by later pops on @vq.  Calling
+ * g_free() on the element instead remains valid.
+ */
+void virtqueue_element_release(VirtQueue *vq, void *elem);
 unsigned int virtqueue_drop_all(VirtQueue *vq);
 void *qemu_get_virtqueue_element(VirtIODevice *vdev, QEMUFile *f, size_t sz);
 void qemu_put_virtqueue_element(VirtIODevice *vdev, QEMUFile *f,
@@ -310,6 +310,14 @@ struct AioContext {
     int64_t poll_grow;      /* polling time growth factor */
     int64_t poll_shrink;    /* polling time shrink factor */
 
+    /*
+     * Polling statistics.  Written only by the event loop thread, with
+     * qatomic_set() so that they can be read from other threads.
+     */
+    uint64_t poll_hits;     /* polling rounds that found an event */
+    uint64_t poll_misses;   /* polling rounds that timed out */
+    uint64_t poll_time_ns;  /* total time spent busy polling */
+
     /* AIO engine parameters */
     int64_t aio_max_batch;  /* maximum number of requests in a batch */
 
@@ -284,6 +284,27 @@ void qemu_coroutine_inc_pool_size(unsigned int additional_pool_size);
  */
 void qemu_coroutine_dec_pool_size(unsigned int additional_pool_size);
 
+/**
+ * Set the number of unused coroutines the calling thread keeps in its local
+ * pool before handing them to the global pool. Busy threads that create
+ * coroutines in large bursts can raise this to avoid allocating new stacks.
+ * 0 selects the default.
+ */
+void qemu_coroutine_set_local_pool_size(unsigned int size);
+
+typedef struct CoroutinePoolStats {
+    uint64_t pool_hits;         /* coroutines recycled from a pool */
+    uint64_t pool_misses;       /* coroutines allocated from scratch */
+    uint64_t allocated;         /* coroutines in existence, pooled or not */
+    uint64_t allocated_peak;    /* high-water mark of @allocated */
+    uint64_t global_pool_size;  /* coroutines in the global pool */
+} CoroutinePoolStats;
+
+/**
+ * Get process-wide coroutine pool statistics
+ */
+void qemu_coroutine_get_pool_stats(CoroutinePoolStats *stats);
+
 /**
  * Sends a (part of) iovec down a socket, yielding when the socket is full, or
  * Receives data into a (part of) iovec from a socket,
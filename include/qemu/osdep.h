@@ -757,6 +757,44 @@ bool qemu_prealloc_mem(int fd, char *area, size_t sz, int max_threads,
  */
 bool qemu_finish_async_prealloc_mem(Error **errp);
 
+typedef struct MemPreallocBackground MemPreallocBackground;
+
+/**
+ * qemu_prealloc_mem_background:
+ * @fd: the fd mapped into the area, -1 for anonymous memory
+ * @area: start address of the are to preallocate
+ * @sz: the size of the area to preallocate
+ * @max_threads: maximum number of threads to use
+ * @tc: prealloc context threads pointer, NULL if not in use
+ * @cb: called with 0 or a negative errno from a preallocation thread once
+ *      preallocation finished or failed
+ * @opaque: opaque pointer passed to @cb
+ * @errp: returns an error if preallocation cannot be started
+ *
+ * Start preallocating memory like qemu_prealloc_mem() in background
+ * threads, without waiting for it.  The memory may be used concurrently;
+ * pages are populated roughly in ascending address order, and pages that
+ * are accessed before they are populated get faulted in on demand as usual.
+ *
+ * The returned handle must be released with
+ * qemu_prealloc_mem_background_free().
+ *
+ * Return: a handle on success, else NULL setting @errp with error.
+ */
+MemPreallocBackground *
+qemu_prealloc_mem_background(int fd, char *area, size_t sz, int max_threads,
+                             ThreadContext *tc,
+                             void (*cb)(void *opaque, int ret), void *opaque,
+                             Error **errp);
+
+/**
+ * qemu_prealloc_mem_background_free:
+ * @bg: the background preallocation
+ *
+ * Wait for the preallocation threads to exit and free @bg.
+ */
+void qemu_prealloc_mem_background_free(MemPreallocBackground *bg);
+
 /**
  * qemu_get_pid_name:
  * @pid: pid of a process
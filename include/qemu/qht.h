@@ -48,6 +48,7 @@ typedef bool (*qht_iter_bool_func_t)(void *p, uint32_t h, void *up);
 
 #define QHT_MODE_AUTO_RESIZE 0x1 /* auto-resize when heavily loaded */
 #define QHT_MODE_RAW_MUTEXES 0x2 /* bypass the profiler (QSP) */
+#define QHT_MODE_INTERLEAVE  0x4 /* interleave buckets across NUMA nodes */
 
 /**
  * qht_init - Initialize a QHT
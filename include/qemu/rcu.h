@@ -143,6 +143,22 @@ struct rcu_head {
 void call_rcu1(struct rcu_head *head, RCUCBFunc *func);
 void drain_call_rcu(void);
 
+typedef struct RCUStats {
+    uint64_t pending;               /* callbacks waiting to be run */
+    uint64_t pending_peak;          /* high-water mark of @pending */
+    uint64_t callbacks;             /* callbacks run so far */
+    uint64_t grace_periods;         /* grace periods waited for */
+    uint64_t forced_grace_periods;  /* ... that had to kick the readers */
+    uint64_t grace_period_ns;       /* total time spent in grace periods */
+    uint64_t grace_period_max_ns;   /* longest grace period */
+} RCUStats;
+
+/**
+ * rcu_get_stats:
+ * Get process-wide statistics about RCU callbacks and grace periods.
+ */
+void rcu_get_stats(RCUStats *stats);
+
 /* The operands of the minus operator must have the same type,
  * which must be the one that we specify in the cast.
  */
@@ -16,6 +16,7 @@
 #include "io/channel-file.h"
 #include "io/net-listener.h"
 #include "qapi/error.h"
+#include "qemu/thread.h"
 #include "standard-headers/linux/virtio_blk.h"
 
 /* A kick fd that we monitor on behalf of libvhost-user */
@@ -27,24 +28,55 @@ typedef struct VuFdWatch {
     QTAILQ_ENTRY(VuFdWatch) next;
 } VuFdWatch;
 
+typedef struct VuServer VuServer;
+
+/* A virtqueue whose kicks are handled in its own AioContext */
+typedef struct VuServerVq {
+    VuServer *server;
+    unsigned int idx;
+    AioContext *ctx;
+
+    /*
+     * Held while the virtqueue is processed, and for all virtqueues while a
+     * vhost-user message is handled, so that messages never change the
+     * device state under a running virtqueue.
+     */
+    QemuRecMutex lock;
+} VuServerVq;
+
 /**
  * VuServer:
  * A vhost-user server instance with user-defined VuDevIface callbacks.
  * Vhost-user device backends can be implemented using VuServer. VuDevIface
- * callbacks and virtqueue kicks run in the given AioContext.
+ * callbacks and virtqueue kicks run in the given AioContext, unless
+ * virtqueues were spread over several AioContexts when starting the server.
  */
-typedef struct {
+struct VuServer {
     QIONetListener *listener;
     QEMUBH *restart_listener_bh;
     AioContext *ctx;
     int max_queues;
     const VuDevIface *vu_iface;
 
+    /* max_queues entries if virtqueues have their own AioContext, or NULL */
+    VuServerVq *vqs;
+
+    /* Protects vu_fd_watches against kick handlers of other virtqueues */
+    QemuMutex watch_lock;
+
+    /* All virtqueue locks are held while handling a message */
+    bool msg_locked;
+
     unsigned int in_flight; /* atomic */
 
+    /*
+     * Set by co_trip while it waits for in_flight to drop to zero; whoever
+     * clears it (atomically) is responsible for waking co_trip
+     */
+    bool wait_idle;
+
     /* Protected by ctx lock */
     bool in_qio_channel_yield;
-    bool wait_idle;
     bool quiescing;
     VuDev vu_dev;
     QIOChannel *ioc; /* The I/O channel with the client */
@@ -52,17 +84,28 @@ typedef struct {
     QTAILQ_HEAD(, VuFdWatch) vu_fd_watches;
 
     Coroutine *co_trip; /* coroutine for processing VhostUserMsg */
-} VuServer;
+};
 
+/*
+ * If @n_vq_ctxs is non-zero, kicks of virtqueue i are handled in
+ * @vq_ctxs[i % @n_vq_ctxs] instead of @ctx.  VuDevIface callbacks still run
+ * in @ctx.  Code outside of the kick handlers that accesses a virtqueue must
+ * then hold vhost_user_server_lock_vq().
+ */
 bool vhost_user_server_start(VuServer *server,
                              SocketAddress *unix_socket,
                              AioContext *ctx,
+                             AioContext **vq_ctxs,
+                             size_t n_vq_ctxs,
                              uint16_t max_queues,
                              const VuDevIface *vu_iface,
                              Error **errp);
 
 void vhost_user_server_stop(VuServer *server);
 
+void vhost_user_server_lock_vq(VuServer *server, VuVirtq *vq);
+void vhost_user_server_unlock_vq(VuServer *server, VuVirtq *vq);
+
 void vhost_user_server_inc_in_flight(VuServer *server);
 void vhost_user_server_dec_in_flight(VuServer *server);
 bool vhost_user_server_has_in_flight(VuServer *server);
@@ -67,6 +67,11 @@ struct HostMemoryBackendClass {
  * @size: amount of memory backend provides
  * @mr: MemoryRegion representing host memory belonging to backend
  * @prealloc_threads: number of threads to be used for preallocatining RAM
+ * @prealloc_node_affinity: if no @prealloc_context is set, place the
+ *   preallocation threads on the CPUs of the bound host NUMA nodes
+ * @prealloc_background: preallocate in background threads instead of
+ *   blocking until all memory is populated
+ * @prealloc_bg: the running background preallocation, if any
  */
 struct HostMemoryBackend {
     /* private */
@@ -79,6 +84,10 @@ struct HostMemoryBackend {
     bool guest_memfd, aligned;
     uint32_t prealloc_threads;
     ThreadContext *prealloc_context;
+    bool prealloc_node_affinity;
+    bool prealloc_background;
+    MemPreallocBackground *prealloc_bg;
+    int prealloc_background_ret;
     DECLARE_BITMAP(host_nodes, MAX_NODES + 1);
     HostMemPolicy policy;
 
@@ -91,6 +100,8 @@ MemoryRegion *host_memory_backend_get_memory(HostMemoryBackend *backend);
 void host_memory_backend_set_mapped(HostMemoryBackend *backend, bool mapped);
 bool host_memory_backend_is_mapped(HostMemoryBackend *backend);
 size_t host_memory_backend_pagesize(HostMemoryBackend *memdev);
+bool host_memory_backend_prealloc(HostMemoryBackend *backend, void *ptr,
+                                  uint64_t sz, bool async, Error **errp);
 char *host_memory_backend_get_name(HostMemoryBackend *backend);
 
 long qemu_minrampagesize(void);
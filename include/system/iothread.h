@@ -38,6 +38,9 @@ struct IOThread {
     int64_t poll_max_ns;
     int64_t poll_grow;
     int64_t poll_shrink;
+
+    /* Size of the thread's local coroutine pool, 0 for the default */
+    int64_t coroutine_pool_size;
 };
 typedef struct IOThread IOThread;
 
@@ -549,6 +549,17 @@ bool kvm_dirty_ring_enabled(void);
 
 uint32_t kvm_dirty_ring_size(void);
 
+/**
+ * kvm_dirty_ring_get_stats - get dirty ring statistics since the VM started
+ * @ring_full_exits: number of KVM_EXIT_DIRTY_RING_FULL exits of all vCPUs
+ * @reap_count: number of reaps that collected dirty pages
+ * @reap_time_ns: total time spent in those reaps, in nanoseconds
+ *
+ * Must only be called if kvm_dirty_ring_enabled() returns true.
+ */
+void kvm_dirty_ring_get_stats(uint64_t *ring_full_exits,
+                              uint64_t *reap_count, uint64_t *reap_time_ns);
+
 void kvm_mark_guest_state_protected(void);
 
 /**
@@ -13,6 +13,7 @@
 #include "qapi/qapi-types-common.h"
 #include "qemu/accel.h"
 #include "qemu/queue.h"
+#include "qemu/thread.h"
 #include "system/kvm.h"
 #include "accel/accel-ops.h"
 #include "hw/core/boards.h"
@@ -91,6 +92,18 @@ enum KVMDirtyRingReaperState {
     KVM_DIRTY_RING_REAPER_REAPING,
 };
 
+/*
+ * Helper thread that harvests one slice of the vCPU dirty rings in parallel
+ * with the thread that initiated the reap.
+ */
+typedef struct KVMDirtyRingReapWorker {
+    QemuThread thread;
+    QemuSemaphore sem;          /* posted to start reaping the slice */
+    KVMState *s;
+    unsigned int slice;         /* index of the vCPU slice to reap */
+    uint64_t total;             /* dirty pages collected in the last round */
+} KVMDirtyRingReapWorker;
+
 /*
  * KVM reaper instance, responsible for collecting the KVM dirty bits
  * via the dirty ring.
@@ -100,6 +113,22 @@ struct KVMDirtyRingReaper {
     QemuThread reaper_thr;
     volatile uint64_t reaper_iteration; /* iteration number of reaper thr */
     volatile enum KVMDirtyRingReaperState reaper_state; /* reap thr state */
+
+    /*
+     * Parallel reaping: the vCPUs are split into slices of vcpus_per_slice
+     * vCPUs (by cpu_index).  Slice 0 is reaped by the initiating thread,
+     * the others by the helper threads in workers[].  vcpus_per_slice is 0
+     * and nr_workers is 0 if all rings are reaped serially.
+     */
+    uint32_t vcpus_per_slice;
+    unsigned int nr_workers;
+    KVMDirtyRingReapWorker *workers;
+    QemuSemaphore sem_done;     /* posted by each worker after its slice */
+
+    /* Statistics, accessed with atomics */
+    uint64_t ring_full_exits;   /* KVM_EXIT_DIRTY_RING_FULL exits */
+    uint64_t reap_count;        /* number of reaps that collected pages */
+    uint64_t reap_time_ns;      /* total time spent in those reaps */
 };
 struct KVMState
 {
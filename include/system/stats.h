@@ -42,4 +42,45 @@ void add_stats_schema(StatsSchemaList **, StatsProvider, StatsTarget,
  */
 bool apply_str_list_filter(const char *string, strList *list);
 
+/*
+ * A uint64_t member of a structure holding VM-wide statistics, for
+ * providers whose stats are a fixed set of scalars.
+ *
+ * @name: name of the statistic
+ * @type: kind of the statistic
+ * @nanoseconds: true if the value is a time in nanoseconds
+ * @offset: offset of the value in the structure
+ */
+typedef struct StatsTableEntry {
+    const char *name;
+    StatsType type;
+    bool nanoseconds;
+    size_t offset;
+} StatsTableEntry;
+
+/*
+ * Add the statistics of @table that match @names, read from @data, as
+ * a VM-wide entry of @provider.  Nothing is added if no names match.
+ */
+void add_stats_table_entry(StatsResultList **, StatsProvider,
+                           const StatsTableEntry *table, size_t n,
+                           const void *data, strList *names);
+
+/*
+ * Add the schema of all statistics in @table as the VM-wide schema of
+ * @provider.
+ */
+void add_stats_table_schema(StatsSchemaList **, StatsProvider,
+                            const StatsTableEntry *table, size_t n);
+
+/*
+ * Register the "coroutine" stats provider.
+ */
+void coroutine_stats_init(void);
+
+/*
+ * Register the "rcu" stats provider.
+ */
+void rcu_stats_init(void);
+
 #endif /* STATS_H */
@@ -0,0 +1,56 @@
+/*
+ * Host-native implementations of guest library functions
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+#ifndef USER_NATIVE_CALL_H
+#define USER_NATIVE_CALL_H
+
+#include "exec/vaddr.h"
+#include "user/abitypes.h"
+
+/*
+ * Set by -native-libc: look up well-known string and memory functions
+ * in the symbol tables of the loaded images and run calls to them on
+ * the host instead of translating the guest implementation.
+ */
+extern bool native_call_enabled;
+
+/**
+ * native_call_add_symbol:
+ * @name: symbol name
+ * @addr: guest address of the function
+ *
+ * Called by the ELF loader for each global function symbol of an image.
+ * Registers @addr if @name is one of the functions that have a host-native
+ * implementation.
+ */
+void native_call_add_symbol(const char *name, abi_ulong addr);
+
+/**
+ * native_call_lookup:
+ * @pc: guest address
+ *
+ * Return true if @pc is the entry point of a function with a host-native
+ * implementation. The translator then raises the target's native call
+ * exception instead of translating the instruction at @pc, and cpu_loop
+ * calls native_call_run() with the arguments of the call.
+ */
+bool native_call_lookup(vaddr pc);
+
+/**
+ * native_call_run:
+ * @pc: guest address of the called function
+ * @args: the first three integer arguments of the call
+ * @ret: return value of the call
+ * @fault_addr: guest address that could not be accessed
+ *
+ * Run the host-native implementation of the function at @pc.  All guest
+ * memory that the function accesses is validated up front; if any of it
+ * is not accessible, nothing is modified, @fault_addr is set and false is
+ * returned so that the caller can deliver SIGSEGV to the guest.
+ */
+bool native_call_run(abi_ulong pc, const abi_ulong args[3], abi_ulong *ret,
+                     abi_ulong *fault_addr);
+
+#endif /* USER_NATIVE_CALL_H */
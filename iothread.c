@@ -24,6 +24,7 @@
 #include "qemu/error-report.h"
 #include "qemu/rcu.h"
 #include "qemu/main-loop.h"
+#include "qemu/coroutine.h"
 
 
 #ifdef CONFIG_POSIX
@@ -47,6 +48,7 @@ static void *iothread_run(void *opaque)
      */
     g_main_context_push_thread_default(iothread->worker_context);
     qemu_set_current_aio_context(iothread->ctx);
+    qemu_coroutine_set_local_pool_size(iothread->coroutine_pool_size);
     iothread->thread_id = qemu_get_thread_id();
     qemu_sem_post(&iothread->init_done_sem);
 
@@ -233,6 +235,9 @@ static IOThreadParamInfo poll_grow_info = {
 static IOThreadParamInfo poll_shrink_info = {
     "poll-shrink", offsetof(IOThread, poll_shrink),
 };
+static IOThreadParamInfo coroutine_pool_size_info = {
+    "coroutine-pool-size", offsetof(IOThread, coroutine_pool_size),
+};
 
 static void iothread_get_param(Object *obj, Visitor *v,
         const char *name, IOThreadParamInfo *info, Error **errp)
@@ -292,6 +297,40 @@ static void iothread_set_poll_param(Object *obj, Visitor *v,
     }
 }
 
+/* Runs in iothread_run() thread */
+static void iothread_set_coroutine_pool_size_bh(void *opaque)
+{
+    IOThread *iothread = opaque;
+
+    qemu_coroutine_set_local_pool_size(iothread->coroutine_pool_size);
+}
+
+static void iothread_set_coroutine_pool_size(Object *obj, Visitor *v,
+        const char *name, void *opaque, Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+    IOThreadParamInfo *info = opaque;
+    int64_t old = iothread->coroutine_pool_size;
+
+    if (!iothread_set_param(obj, v, name, info, errp)) {
+        return;
+    }
+
+    if (iothread->coroutine_pool_size > UINT_MAX) {
+        error_setg(errp, "%s value must be in range [0, %u]",
+                   info->name, UINT_MAX);
+        iothread->coroutine_pool_size = old;
+        return;
+    }
+
+    /* The pool size is thread-local, so it must be set by the thread itself */
+    if (iothread->ctx) {
+        aio_bh_schedule_oneshot(iothread->ctx,
+                                iothread_set_coroutine_pool_size_bh,
+                                iothread);
+    }
+}
+
 static void iothread_class_init(ObjectClass *klass, const void *class_data)
 {
     EventLoopBaseClass *bc = EVENT_LOOP_BASE_CLASS(klass);
@@ -311,6 +350,10 @@ static void iothread_class_init(ObjectClass *klass, const void *class_data)
                               iothread_get_poll_param,
                               iothread_set_poll_param,
                               NULL, &poll_shrink_info);
+    object_class_property_add(klass, "coroutine-pool-size", "int",
+                              iothread_get_poll_param,
+                              iothread_set_coroutine_pool_size,
+                              NULL, &coroutine_pool_size_info);
 }
 
 static const TypeInfo iothread_info = {
@@ -357,6 +400,9 @@ static int query_one_iothread(Object *object, void *opaque)
     info->poll_grow = iothread->poll_grow;
     info->poll_shrink = iothread->poll_shrink;
     info->aio_max_batch = iothread->parent_obj.aio_max_batch;
+    info->poll_hits = qatomic_read(&iothread->ctx->poll_hits);
+    info->poll_misses = qatomic_read(&iothread->ctx->poll_misses);
+    info->poll_time_ns = qatomic_read(&iothread->ctx->poll_time_ns);
 
     QAPI_LIST_APPEND(*tail, info);
     return 0;
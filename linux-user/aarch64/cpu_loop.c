@@ -21,6 +21,7 @@
 #include "qemu.h"
 #include "user-internals.h"
 #include "user/cpu_loop.h"
+#include "user/native-call.h"
 #include "signal-common.h"
 #include "qemu/guest-random.h"
 #include "semihosting/common-semi.h"
@@ -203,6 +204,23 @@ void cpu_loop(CPUARMState *env)
             do_common_semihosting(cs);
             env->pc += 4;
             break;
+        case EXCP_NATIVE_CALL:
+        {
+            abi_ulong args[3] = {
+                env->xregs[0], env->xregs[1], env->xregs[2]
+            };
+            abi_ulong fault_addr, native_ret;
+
+            if (native_call_run(env->pc, args, &native_ret, &fault_addr)) {
+                /* Return to the caller as the function's RET would */
+                env->xregs[0] = native_ret;
+                env->pc = env->xregs[30];
+            } else {
+                force_sig_fault(TARGET_SIGSEGV, TARGET_SEGV_MAPERR,
+                                fault_addr);
+            }
+            break;
+        }
         case EXCP_YIELD:
             /* nothing to do here for user-mode, just resume guest code */
             break;
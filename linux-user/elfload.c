@@ -14,6 +14,7 @@
 #include "exec/translation-block.h"
 #include "exec/tswap.h"
 #include "user/guest-base.h"
+#include "user/native-call.h"
 #include "user-internals.h"
 #include "signal-common.h"
 #include "loader.h"
@@ -1566,7 +1567,7 @@ static void load_elf_image(const char *image_name, const ImageSource *src,
         info->end_data = info->end_code;
     }
 
-    if (qemu_log_enabled()) {
+    if (qemu_log_enabled() || native_call_enabled) {
         load_symbols(ehdr, src, load_bias);
     }
 
@@ -1722,7 +1723,7 @@ static void load_symbols(struct elfhdr *hdr, const ImageSource *src,
     char *strings = NULL;
     struct elf_sym *syms = NULL;
     struct elf_sym *new_syms;
-    uint64_t segsz;
+    uint64_t segsz, strsz;
 
     shnum = hdr->e_shnum;
     shdr = imgsrc_read_alloc(hdr->e_shoff, shnum * sizeof(struct elf_shdr),
@@ -1746,12 +1747,12 @@ static void load_symbols(struct elfhdr *hdr, const ImageSource *src,
  found:
     /* Now know where the strtab and symtab are.  Snarf them.  */
 
-    segsz = shdr[str_idx].sh_size;
-    strings = g_try_malloc(segsz);
+    strsz = shdr[str_idx].sh_size;
+    strings = g_try_malloc(strsz);
     if (!strings) {
         goto give_up;
     }
-    if (!imgsrc_read(strings, shdr[str_idx].sh_offset, segsz, src, NULL)) {
+    if (!imgsrc_read(strings, shdr[str_idx].sh_offset, strsz, src, NULL)) {
         goto give_up;
     }
 
@@ -1787,6 +1788,13 @@ static void load_symbols(struct elfhdr *hdr, const ImageSource *src,
             syms[i].st_value &= ~(target_ulong)1;
 #endif
             syms[i].st_value += load_bias;
+            if (ELF_ST_BIND(syms[i].st_info) != STB_LOCAL &&
+                syms[i].st_name < strsz &&
+                memchr(strings + syms[i].st_name, 0,
+                       strsz - syms[i].st_name)) {
+                native_call_add_symbol(strings + syms[i].st_name,
+                                       syms[i].st_value);
+            }
             i++;
         }
     }
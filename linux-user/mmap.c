@@ -1249,7 +1249,21 @@ abi_long target_madvise(abi_ulong start, abi_ulong len_in, int advice)
      * success, which is broken but some userspace programs fail to work
      * otherwise. Completely implementing such emulation is quite complicated
      * though.
+     *
+     * Allocators issue hints such as MADV_FREE at a high rate from many
+     * threads, so return before taking mmap_lock for those.
      */
+    switch (advice) {
+    case MADV_DONTDUMP:
+    case MADV_DODUMP:
+    case MADV_WIPEONFORK:
+    case MADV_KEEPONFORK:
+    case MADV_DONTNEED:
+        break;
+    default:
+        return 0;
+    }
+
     mmap_lock();
     switch (advice) {
     case MADV_DONTDUMP:
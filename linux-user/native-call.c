@@ -0,0 +1,156 @@
+/*
+ * Host-native implementations of guest library functions
+ *
+ * The string and memory functions of the C library are hot in many guest
+ * workloads, yet they are translated instruction by instruction.  When
+ * enabled with -native-libc, the entry points of a few of them are looked
+ * up in the symbol tables of the loaded images, and calls to them are run
+ * on the host after validating the guest memory they touch.
+ *
+ * Only plain STT_FUNC symbols are used: IFUNC resolvers select one of
+ * several implementations at run time, and intercepting the resolver
+ * would not catch calls to the implementation it returns.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu.h"
+#include "user-internals.h"
+#include "user/native-call.h"
+#include "trace.h"
+
+typedef enum NativeCallFunc {
+    NATIVE_CALL_MEMCPY = 1,
+    NATIVE_CALL_MEMMOVE,
+    NATIVE_CALL_MEMSET,
+    NATIVE_CALL_MEMCMP,
+    NATIVE_CALL_STRLEN,
+} NativeCallFunc;
+
+static const char * const native_call_names[] = {
+    [NATIVE_CALL_MEMCPY] = "memcpy",
+    [NATIVE_CALL_MEMMOVE] = "memmove",
+    [NATIVE_CALL_MEMSET] = "memset",
+    [NATIVE_CALL_MEMCMP] = "memcmp",
+    [NATIVE_CALL_STRLEN] = "strlen",
+};
+
+bool native_call_enabled;
+
+/*
+ * Guest address -> NativeCallFunc.  Filled in while loading the images,
+ * before any guest code runs, and read-only afterwards.
+ */
+static GHashTable *native_calls;
+
+void native_call_add_symbol(const char *name, abi_ulong addr)
+{
+    int i;
+
+    if (!native_call_enabled) {
+        return;
+    }
+
+    for (i = 1; i < ARRAY_SIZE(native_call_names); i++) {
+        if (!strcmp(name, native_call_names[i])) {
+            if (!native_calls) {
+                native_calls = g_hash_table_new(NULL, NULL);
+            }
+            g_hash_table_insert(native_calls, (gpointer)(uintptr_t)addr,
+                                GINT_TO_POINTER(i));
+            trace_native_call_add_symbol(name, addr);
+            return;
+        }
+    }
+}
+
+static NativeCallFunc native_call_find(vaddr pc)
+{
+    if (!native_calls) {
+        return 0;
+    }
+    return GPOINTER_TO_INT(g_hash_table_lookup(native_calls,
+                                               (gpointer)(uintptr_t)pc));
+}
+
+bool native_call_lookup(vaddr pc)
+{
+    return native_call_find(pc) != 0;
+}
+
+bool native_call_run(abi_ulong pc, const abi_ulong args[3], abi_ulong *ret,
+                     abi_ulong *fault_addr)
+{
+    abi_ulong len = args[2];
+    ssize_t slen;
+    void *dst, *src;
+    NativeCallFunc func = native_call_find(pc);
+
+    /* Like the real functions, don't touch the pointers for empty ranges */
+    if (len == 0 && func != NATIVE_CALL_STRLEN) {
+        *ret = func == NATIVE_CALL_MEMCMP ? 0 : args[0];
+        return true;
+    }
+
+    switch (func) {
+    case NATIVE_CALL_MEMCPY:
+    case NATIVE_CALL_MEMMOVE:
+        dst = lock_user(VERIFY_WRITE, args[0], len, false);
+        if (!dst) {
+            *fault_addr = args[0];
+            return false;
+        }
+        src = lock_user(VERIFY_READ, args[1], len, true);
+        if (!src) {
+            unlock_user(dst, args[0], 0);
+            *fault_addr = args[1];
+            return false;
+        }
+        memmove(dst, src, len);
+        unlock_user(src, args[1], 0);
+        unlock_user(dst, args[0], len);
+        *ret = args[0];
+        return true;
+
+    case NATIVE_CALL_MEMSET:
+        dst = lock_user(VERIFY_WRITE, args[0], len, false);
+        if (!dst) {
+            *fault_addr = args[0];
+            return false;
+        }
+        memset(dst, args[1] & 0xff, len);
+        unlock_user(dst, args[0], len);
+        *ret = args[0];
+        return true;
+
+    case NATIVE_CALL_MEMCMP:
+        dst = lock_user(VERIFY_READ, args[0], len, true);
+        if (!dst) {
+            *fault_addr = args[0];
+            return false;
+        }
+        src = lock_user(VERIFY_READ, args[1], len, true);
+        if (!src) {
+            unlock_user(dst, args[0], 0);
+            *fault_addr = args[1];
+            return false;
+        }
+        *ret = (abi_long)memcmp(dst, src, len);
+        unlock_user(src, args[1], 0);
+        unlock_user(dst, args[0], 0);
+        return true;
+
+    case NATIVE_CALL_STRLEN:
+        slen = target_strlen(args[0]);
+        if (slen < 0) {
+            *fault_addr = args[0];
+            return false;
+        }
+        *ret = slen;
+        return true;
+
+    default:
+        g_assert_not_reached();
+    }
+}
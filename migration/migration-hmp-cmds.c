@@ -284,6 +284,16 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
                        info->dirty_limit_ring_full_time);
     }
 
+    if (info->has_dirty_ring_full_exits) {
+        monitor_printf(mon, "Dirty ring full exits: %" PRIu64 "\n",
+                       info->dirty_ring_full_exits);
+    }
+
+    if (info->has_dirty_ring_reap_latency) {
+        monitor_printf(mon, "Dirty ring reap latency (us): %" PRIu64 "\n",
+                       info->dirty_ring_reap_latency);
+    }
+
     migration_dump_blocktime(mon, info);
 out:
     qapi_free_MigrationInfo(info);
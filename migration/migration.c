@@ -1115,6 +1115,17 @@ static void populate_ram_info(MigrationInfo *info, MigrationState *s)
         info->has_dirty_limit_ring_full_time = true;
         info->dirty_limit_ring_full_time = dirtylimit_ring_full_time();
     }
+
+    if (kvm_dirty_ring_enabled()) {
+        uint64_t reap_count, reap_time_ns;
+
+        kvm_dirty_ring_get_stats(&info->dirty_ring_full_exits,
+                                 &reap_count, &reap_time_ns);
+        info->has_dirty_ring_full_exits = true;
+        info->has_dirty_ring_reap_latency = true;
+        info->dirty_ring_reap_latency =
+            reap_count ? reap_time_ns / reap_count / 1000 : 0;
+    }
 }
 
 static void fill_source_migration_info(MigrationInfo *info)
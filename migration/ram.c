@@ -39,6 +39,7 @@
 #include "migration/register.h"
 #include "migration/misc.h"
 #include "qemu-file.h"
+#include "io/channel-file.h"
 #include "postcopy-ram.h"
 #include "page_cache.h"
 #include "qemu/error-report.h"
@@ -4040,21 +4041,61 @@ static size_t ram_load_multifd_pages(void *host_addr, size_t size,
     return size;
 }
 
+/**
+ * mapped_ram_block_is_template: Check whether a RAM block is a private
+ * mapping of its own pages in the mapped-ram migration file
+ *
+ * A memory-backend-file with share=off whose mem-path and offset point at
+ * the pages of the RAM block in the incoming mapped-ram file already holds
+ * the saved contents, and shares them copy-on-write with every other QEMU
+ * instance that maps the same file.  Loading it only needs to clear the
+ * pages that the file marks as zero.
+ *
+ * This only applies to -incoming, before any other write to guest RAM.
+ *
+ * Returns: true if the pages of @block do not need to be read.
+ * @pages_offset: Offset of the pages of @block in the migration file
+ */
+static bool mapped_ram_block_is_template(QEMUFile *f, RAMBlock *block,
+                                         uint64_t pages_offset)
+{
+    QIOChannel *ioc = qemu_file_get_ioc(f);
+    struct stat file_st, block_st;
+
+    if (!runstate_check(RUN_STATE_INMIGRATE) ||
+        !object_dynamic_cast(OBJECT(ioc), TYPE_QIO_CHANNEL_FILE) ||
+        qemu_ram_get_fd(block) < 0 || qemu_ram_is_shared(block) ||
+        qemu_ram_get_fd_offset(block) != pages_offset) {
+        return false;
+    }
+
+    if (fstat(QIO_CHANNEL_FILE(ioc)->fd, &file_st) < 0 ||
+        fstat(qemu_ram_get_fd(block), &block_st) < 0) {
+        return false;
+    }
+
+    return file_st.st_dev == block_st.st_dev &&
+           file_st.st_ino == block_st.st_ino;
+}
+
 /**
  * handle_zero_mapped_ram: Zero out a range of RAM pages if required during
  * mapped-ram load
  *
- * Zeroing is only performed when restoring from a snapshot (HMP loadvm).
- * During incoming migration or -loadvm cli snapshot load, the function is a
- * no-op and returns true as in those cases the pages are already guaranteed to
+ * Zeroing is only performed when restoring from a snapshot (HMP loadvm), or
+ * when the RAM block maps the migration file itself, whose pages may hold
+ * stale data for pages that became zero during migration.  Otherwise the
+ * function is a no-op and returns true as the pages are already guaranteed to
  * be zeroed.
  *
  * Returns: true on success, false on error (with @errp set).
  * @from_bit_idx: Starting index relative to the map of the page (inclusive)
  * @to_bit_idx:   Ending index relative to the map of the page (exclusive)
+ * @template:     Whether the RAM block maps the migration file
  */
 static bool handle_zero_mapped_ram(RAMBlock *block, unsigned long from_bit_idx,
-                                   unsigned long to_bit_idx, Error **errp)
+                                   unsigned long to_bit_idx, bool template,
+                                   Error **errp)
 {
     ERRP_GUARD();
     ram_addr_t offset;
@@ -4063,9 +4104,9 @@ static bool handle_zero_mapped_ram(RAMBlock *block, unsigned long from_bit_idx,
 
     /*
      * Zeroing is not needed for either -loadvm (RUN_STATE_PRELAUNCH), or
-     * -incoming (RUN_STATE_INMIGRATE).
+     * -incoming (RUN_STATE_INMIGRATE) into anonymous memory.
      */
-    if (!runstate_check(RUN_STATE_RESTORE_VM)) {
+    if (!template && !runstate_check(RUN_STATE_RESTORE_VM)) {
         return true;
     }
 
@@ -4088,7 +4129,7 @@ static bool handle_zero_mapped_ram(RAMBlock *block, unsigned long from_bit_idx,
 
 static bool read_ramblock_mapped_ram(QEMUFile *f, RAMBlock *block,
                                      long num_pages, unsigned long *bitmap,
-                                     Error **errp)
+                                     bool template, Error **errp)
 {
     ERRP_GUARD();
     unsigned long set_bit_idx, clear_bit_idx = 0;
@@ -4101,13 +4142,19 @@ static bool read_ramblock_mapped_ram(QEMUFile *f, RAMBlock *block,
          set_bit_idx = find_next_bit(bitmap, num_pages, clear_bit_idx + 1)) {
 
         /* Zero pages */
-        if (!handle_zero_mapped_ram(block, clear_bit_idx, set_bit_idx, errp)) {
+        if (!handle_zero_mapped_ram(block, clear_bit_idx, set_bit_idx,
+                                    template, errp)) {
             return false;
         }
 
         /* Non-zero pages */
         clear_bit_idx = find_next_zero_bit(bitmap, num_pages, set_bit_idx + 1);
 
+        if (template) {
+            /* Already mapped from the file */
+            continue;
+        }
+
         unread = TARGET_PAGE_SIZE * (clear_bit_idx - set_bit_idx);
         offset = set_bit_idx << TARGET_PAGE_BITS;
 
@@ -4138,7 +4185,8 @@ static bool read_ramblock_mapped_ram(QEMUFile *f, RAMBlock *block,
     }
 
     /* Handle trailing 0 pages */
-    if (!handle_zero_mapped_ram(block, clear_bit_idx, num_pages, errp)) {
+    if (!handle_zero_mapped_ram(block, clear_bit_idx, num_pages, template,
+                                errp)) {
         return false;
     }
 
@@ -4159,6 +4207,7 @@ static void parse_ramblock_mapped_ram(QEMUFile *f, RAMBlock *block,
     MappedRamHeader header;
     size_t bitmap_size;
     long num_pages;
+    bool template;
 
     if (!mapped_ram_read_header(f, &header, errp)) {
         return;
@@ -4194,7 +4243,12 @@ static void parse_ramblock_mapped_ram(QEMUFile *f, RAMBlock *block,
         return;
     }
 
-    if (!read_ramblock_mapped_ram(f, block, num_pages, bitmap, errp)) {
+    template = mapped_ram_block_is_template(f, block, header.pages_offset);
+    trace_ram_load_mapped_ram_block(block->idstr, header.pages_offset,
+                                    template);
+
+    if (!read_ramblock_mapped_ram(f, block, num_pages, bitmap, template,
+                                  errp)) {
         return;
     }
 
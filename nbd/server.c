@@ -101,6 +101,12 @@ struct NBDExport {
     bool allocation_depth;
     BdrvDirtyBitmap **export_bitmaps;
     size_t nr_export_bitmaps;
+
+    /*
+     * Index into common.multithread_ctxs of the AioContext that the next
+     * client will be assigned to. Only accessed from the main loop thread.
+     */
+    size_t next_multithread_ctx;
 };
 
 static QTAILQ_HEAD(, NBDExport) exports = QTAILQ_HEAD_INITIALIZER(exports);
@@ -129,6 +135,11 @@ struct NBDClient {
     QemuMutex lock;
 
     NBDExport *exp;
+    /*
+     * AioContext that processes this client's requests if the export is
+     * multi-threaded, NULL otherwise. Set once the client selects the export.
+     */
+    AioContext *ctx;
     QCryptoTLSCreds *tlscreds;
     char *tlsauthz;
     uint32_t handshake_max_secs;
@@ -159,6 +170,37 @@ struct NBDClient {
 
 static void nbd_client_receive_next_request(NBDClient *client);
 
+/*
+ * Returns the AioContext that processes @client's requests. For
+ * multi-threaded exports, this is fixed per client; otherwise it follows the
+ * AioContext of the export.
+ */
+static AioContext *nbd_client_aio_context(NBDClient *client)
+{
+    return client->ctx ?: nbd_export_aio_context(client->exp);
+}
+
+/*
+ * Attaches @client to @exp after successful negotiation. Clients of
+ * multi-threaded exports are distributed round-robin across the export's
+ * iothreads.
+ */
+static void nbd_client_attach_export(NBDClient *client, NBDExport *exp)
+{
+    BlockExport *blk_exp = &exp->common;
+
+    assert(qemu_in_main_thread());
+
+    client->exp = exp;
+    if (blk_exp->multithread_count) {
+        client->ctx = blk_exp->multithread_ctxs[exp->next_multithread_ctx];
+        exp->next_multithread_ctx = (exp->next_multithread_ctx + 1) %
+                                    blk_exp->multithread_count;
+    }
+    QTAILQ_INSERT_TAIL(&exp->clients, client, next);
+    blk_exp_ref(blk_exp);
+}
+
 /* Basic flow for negotiation
 
    Server         Client
@@ -536,8 +578,7 @@ nbd_negotiate_handle_export_name(NBDClient *client, bool no_zeroes,
         return ret;
     }
 
-    QTAILQ_INSERT_TAIL(&client->exp->clients, client, next);
-    blk_exp_ref(&client->exp->common);
+    nbd_client_attach_export(client, client->exp);
 
     return 0;
 }
@@ -750,10 +791,8 @@ nbd_negotiate_handle_info(NBDClient *client, Error **errp)
     }
 
     if (client->opt == NBD_OPT_GO) {
-        client->exp = exp;
         client->check_align = check_align;
-        QTAILQ_INSERT_TAIL(&client->exp->clients, client, next);
-        blk_exp_ref(&client->exp->common);
+        nbd_client_attach_export(client, exp);
         rc = 1;
     }
     return rc;
@@ -1556,7 +1595,7 @@ static int coroutine_fn nbd_receive_request(NBDClient *client, NBDRequest *reque
 
 #define MAX_NBD_REQUESTS 16
 
-/* Runs in export AioContext and main loop thread */
+/* Runs in the client's AioContext and main loop thread */
 void nbd_client_get(NBDClient *client)
 {
     qatomic_inc(&client->refcount);
@@ -1637,7 +1676,7 @@ static void client_close(NBDClient *client, bool negotiated)
     }
 }
 
-/* Runs in export AioContext with client->lock held */
+/* Runs in the client's AioContext with client->lock held */
 static NBDRequestData *nbd_request_get(NBDClient *client)
 {
     NBDRequestData *req;
@@ -1650,7 +1689,7 @@ static NBDRequestData *nbd_request_get(NBDClient *client)
     return req;
 }
 
-/* Runs in export AioContext with client->lock held */
+/* Runs in the client's AioContext with client->lock held */
 static void nbd_request_put(NBDRequestData *req)
 {
     NBDClient *client = req->client;
@@ -1729,7 +1768,7 @@ static void nbd_drained_end(void *opaque)
     }
 }
 
-/* Runs in export AioContext */
+/* Runs in the client's AioContext, see nbd_client_aio_context() */
 static void nbd_wake_read_bh(void *opaque)
 {
     NBDClient *client = opaque;
@@ -1750,12 +1789,12 @@ static bool nbd_drained_poll(void *opaque)
                  * If there's a coroutine waiting for a request on nbd_read_eof()
                  * enter it here so we don't depend on the client to wake it up.
                  *
-                 * Schedule a BH in the export AioContext to avoid missing the
+                 * Schedule a BH in the client's AioContext to avoid missing the
                  * wake up due to the race between qio_channel_wake_read() and
                  * qio_channel_yield().
                  */
                 if (client->recv_coroutine != NULL && client->read_yielding) {
-                    aio_bh_schedule_oneshot(nbd_export_aio_context(client->exp),
+                    aio_bh_schedule_oneshot(nbd_client_aio_context(client),
                                             nbd_wake_read_bh, client);
                 }
 
@@ -2029,6 +2068,7 @@ const BlockExportDriver blk_exp_nbd = {
     .type               = BLOCK_EXPORT_TYPE_NBD,
     .instance_size      = sizeof(NBDExport),
     .supports_inactive  = true,
+    .supports_multithread = true,
     .create             = nbd_export_create,
     .delete             = nbd_export_delete,
     .request_shutdown   = nbd_export_request_shutdown,
@@ -3197,7 +3237,7 @@ disconnect:
 }
 
 /*
- * Runs in export AioContext and main loop thread. Caller must hold
+ * Runs in the client's AioContext and main loop thread. Caller must hold
  * client->lock.
  */
 static void nbd_client_receive_next_request(NBDClient *client)
@@ -3209,7 +3249,8 @@ static void nbd_client_receive_next_request(NBDClient *client)
         nbd_client_get(client);
         req = nbd_request_get(client);
         client->recv_coroutine = qemu_coroutine_create(nbd_trip, req);
-        aio_co_schedule(client->exp->common.ctx, client->recv_coroutine);
+        aio_co_schedule(nbd_client_aio_context(client),
+                        client->recv_coroutine);
     }
 }
 
@@ -236,6 +236,7 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "                split-wx=on|off (enable TCG split w^x mapping)\n"
     "                tb-size=n (TCG translation block cache size)\n"
     "                dirty-ring-size=n (KVM dirty ring GFN count, default 0)\n"
+    "                dirty-ring-vcpus-per-reaper=n (vCPU dirty rings harvested per KVM reaper thread, default 0)\n"
     "                eager-split-size=n (KVM Eager Page Split chunk size, default 0, disabled. ARM only)\n"
     "                notify-vmexit=run|internal-error|disable,notify-window=n (enable notify VM exit and set notify window, x86 only)\n"
     "                thread=single|multi (enable multi-threaded TCG)\n"
@@ -296,6 +297,13 @@ SRST
         is disabled (dirty-ring-size=0).  When enabled, KVM will instead
         record dirty pages in a bitmap.
 
+    ``dirty-ring-vcpus-per-reaper=n``
+        When the KVM dirty ring is used, harvest the dirty rings in parallel
+        using one thread for each group of n vCPUs.  This shortens the time
+        vCPUs spend waiting for their rings to be reaped on guests with many
+        vCPUs.  By default, all rings are reaped by a single thread
+        (dirty-ring-vcpus-per-reaper=0).
+
     ``eager-split-size=n``
         KVM implements dirty page logging at the PAGE_SIZE granularity and
         enabling dirty-logging on a huge-page requires breaking it into
@@ -1838,7 +1846,7 @@ ERST
 
 DEF("fsdev", HAS_ARG, QEMU_OPTION_fsdev,
     "-fsdev local,id=id,path=path,security_model=mapped-xattr|mapped-file|passthrough|none\n"
-    " [,writeout=immediate][,readonly=on][,fmode=fmode][,dmode=dmode]\n"
+    " [,writeout=immediate][,readonly=on][,fmode=fmode][,dmode=dmode][,cache=none|loose]\n"
     " [[,throttling.bps-total=b]|[[,throttling.bps-read=r][,throttling.bps-write=w]]]\n"
     " [[,throttling.iops-total=i]|[[,throttling.iops-read=r][,throttling.iops-write=w]]]\n"
     " [[,throttling.bps-total-max=bm]|[[,throttling.bps-read-max=rm][,throttling.bps-write-max=wm]]]\n"
@@ -1848,7 +1856,7 @@ DEF("fsdev", HAS_ARG, QEMU_OPTION_fsdev,
     QEMU_ARCH_ALL)
 
 SRST
-``-fsdev local,id=id,path=path,security_model=security_model [,writeout=writeout][,readonly=on][,fmode=fmode][,dmode=dmode] [,throttling.option=value[,throttling.option=value[,...]]]``
+``-fsdev local,id=id,path=path,security_model=security_model [,writeout=writeout][,readonly=on][,fmode=fmode][,dmode=dmode][,cache=cache] [,throttling.option=value[,throttling.option=value[,...]]]``
   \ 
 ``-fsdev synth,id=id[,readonly=on]``
     Define a new file system device. Valid options are:
@@ -1902,6 +1910,16 @@ SRST
         host. Works only with security models "mapped-xattr" and
         "mapped-file".
 
+    ``cache=none|loose``
+        Specifies whether QEMU caches file attributes and path lookups
+        of the export. With "none" (default), every lookup goes to the
+        host file system. With "loose", results are cached for a short
+        time, and for longer in directories QEMU can watch with inotify.
+        Changes made through the export are always visible immediately,
+        but changes made on the host by other processes may take a
+        moment to show up on the guest. Works only with the "local"
+        fsdriver.
+
     ``throttling.bps-total=b,throttling.bps-read=r,throttling.bps-write=w``
         Specify bandwidth throttling limits in bytes per second, either
         for all request types or for reads or writes only.
@@ -1944,11 +1962,12 @@ ERST
 DEF("virtfs", HAS_ARG, QEMU_OPTION_virtfs,
     "-virtfs local,path=path,mount_tag=tag,security_model=mapped-xattr|mapped-file|passthrough|none\n"
     "        [,id=id][,writeout=immediate][,readonly=on][,fmode=fmode][,dmode=dmode][,multidevs=remap|forbid|warn]\n"
+    "        [,cache=none|loose]\n"
     "-virtfs synth,mount_tag=tag[,id=id][,readonly=on]\n",
     QEMU_ARCH_ALL)
 
 SRST
-``-virtfs local,path=path,mount_tag=mount_tag ,security_model=security_model[,writeout=writeout][,readonly=on] [,fmode=fmode][,dmode=dmode][,multidevs=multidevs]``
+``-virtfs local,path=path,mount_tag=mount_tag ,security_model=security_model[,writeout=writeout][,readonly=on] [,fmode=fmode][,dmode=dmode][,multidevs=multidevs][,cache=cache]``
   \ 
 ``-virtfs synth,mount_tag=mount_tag``
     Define a new virtual filesystem device and expose it to the guest using
@@ -2047,6 +2066,16 @@ SRST
         though that "forbid" does currently not block all possible file
         access operations (e.g. readdir() would still return entries from
         other devices).
+
+    ``cache=none|loose``
+        Specifies whether QEMU caches file attributes and path lookups
+        of the export. With "none" (default), every lookup goes to the
+        host file system. With "loose", results are cached for a short
+        time, and for longer in directories QEMU can watch with inotify.
+        Changes made through the export are always visible immediately,
+        but changes made on the host by other processes may take a
+        moment to show up on the guest. Works only with the "local"
+        fsdriver.
 ERST
 
 DEF("iscsi", HAS_ARG, QEMU_OPTION_iscsi,
@@ -2646,8 +2675,11 @@ SRST
         default. An adaptive encoding will try to detect frequently
         updated screen regions, and send updates in these regions using
         a lossy encoding (like JPEG). This can be really helpful to save
-        bandwidth when playing videos. Disabling adaptive encodings
-        restores the original static behavior of encodings like Tight.
+        bandwidth when playing videos. Adaptive encodings also lower the
+        JPEG quality while a client cannot keep up with the updates, and
+        raise it again once the client has caught up. Disabling adaptive
+        encodings restores the original static behavior of encodings like
+        Tight.
 
     ``share=[allow-exclusive|force-shared|ignore]``
         Set display sharing policy. 'allow-exclusive' allows clients to
@@ -2679,6 +2711,14 @@ SRST
     ``power-control=on|off``
         Permit the remote client to issue shutdown, reboot or reset power
         control requests.
+
+    ``encoder-threads=n``
+        Number of threads that encode framebuffer updates. Updates for one
+        client are always encoded in order by one thread at a time, but
+        updates for different clients are encoded in parallel, also when
+        they are connected to the same display. The threads
+        are shared by all VNC displays, so the largest value given for any
+        display is used. Default is 1.
 ERST
 
 ARCHHEADING(, QEMU_ARCH_I386)
@@ -5631,6 +5671,22 @@ SRST
 
         The ``prealloc`` boolean option enables memory preallocation.
 
+        The ``prealloc-background`` boolean option makes preallocation run
+        in background threads, so that the VM can start while memory is
+        still being populated. Pages the guest touches before the
+        background threads reach them are allocated on demand. This is
+        best effort: a failure is only reported, it does not stop the VM.
+        Discarding RAM, e.g. by virtio-balloon or virtio-mem, is disabled
+        until the background threads are done. The option cannot be used
+        together with ``-incoming`` or ``prealloc-node-affinity``.
+
+        The ``prealloc-node-affinity`` boolean option (off by default) makes
+        preallocation threads run on the CPUs of the NUMA host nodes given
+        by ``host-nodes``, unless a ``prealloc-context`` is specified. With
+        policy ``bind`` or ``preferred``, each node preallocates its own
+        share of the memory, so that pages are allocated and zeroed by CPUs
+        local to them.
+
         The ``host-nodes`` option binds the memory range to a list of
         NUMA host nodes.
 
@@ -6361,7 +6417,7 @@ SRST
 
             CN=laptop.example.com,O=Example Home,L=London,ST=London,C=GB
 
-    ``-object iothread,id=id,poll-max-ns=poll-max-ns,poll-grow=poll-grow,poll-shrink=poll-shrink,aio-max-batch=aio-max-batch``
+    ``-object iothread,id=id,poll-max-ns=poll-max-ns,poll-grow=poll-grow,poll-shrink=poll-shrink,aio-max-batch=aio-max-batch,coroutine-pool-size=coroutine-pool-size``
         Creates a dedicated event loop thread that devices can be
         assigned to. This is known as an IOThread. By default device
         emulation happens in vCPU threads or the main event loop thread.
@@ -6401,6 +6457,13 @@ SRST
         in a batch for the AIO engine, 0 means that the engine will use
         its default.
 
+        The ``coroutine-pool-size`` parameter is the number of unused
+        coroutines the IOThread keeps for reuse. Raising it avoids
+        allocating new coroutine stacks when the IOThread creates many
+        coroutines in bursts, at the cost of memory. 0 means the default.
+        The ``coroutine`` provider of ``query-stats`` reports pool hits
+        and misses.
+
         The IOThread parameters can be modified at run-time using the
         ``qom-set`` command (where ``iothread1`` is the IOThread's
         ``id``):
@@ -132,6 +132,9 @@ def __init__(self, file, version_id, ramargs, section_key):
         self.sizeinfo = collections.OrderedDict()
         self.data = collections.OrderedDict()
         self.data['section sizes'] = self.sizeinfo
+        if self.mapped_ram:
+            self.pagesoffsets = collections.OrderedDict()
+            self.data['mapped-ram pages offsets'] = self.pagesoffsets
         self.name = ''
         if self.write_memory:
             self.files = { }
@@ -166,6 +169,8 @@ def parseMappedRamBlob(self, len):
             # for it.
             return
 
+        self.pagesoffsets[self.name] = '0x%016x' % pages_offset
+
         if self.dump_memory or self.write_memory:
             num_pages = len // page_size
 
@@ -0,0 +1,53 @@
+/*
+ * Coroutine pool statistics for query-stats
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/coroutine.h"
+#include "system/stats.h"
+#include "qapi/qapi-commands-stats.h"
+
+static const StatsTableEntry coroutine_stats_table[] = {
+    { "pool-hits", STATS_TYPE_CUMULATIVE, false,
+      offsetof(CoroutinePoolStats, pool_hits) },
+    { "pool-misses", STATS_TYPE_CUMULATIVE, false,
+      offsetof(CoroutinePoolStats, pool_misses) },
+    { "allocated", STATS_TYPE_INSTANT, false,
+      offsetof(CoroutinePoolStats, allocated) },
+    { "allocated-peak", STATS_TYPE_PEAK, false,
+      offsetof(CoroutinePoolStats, allocated_peak) },
+    { "global-pool-size", STATS_TYPE_INSTANT, false,
+      offsetof(CoroutinePoolStats, global_pool_size) },
+};
+
+static void coroutine_stats_cb(StatsResultList **result, StatsTarget target,
+                               strList *names, strList *targets, Error **errp)
+{
+    CoroutinePoolStats pool_stats;
+
+    if (target != STATS_TARGET_VM) {
+        return;
+    }
+
+    qemu_coroutine_get_pool_stats(&pool_stats);
+    add_stats_table_entry(result, STATS_PROVIDER_COROUTINE,
+                          coroutine_stats_table,
+                          ARRAY_SIZE(coroutine_stats_table),
+                          &pool_stats, names);
+}
+
+static void coroutine_stats_schemas_cb(StatsSchemaList **result, Error **errp)
+{
+    add_stats_table_schema(result, STATS_PROVIDER_COROUTINE,
+                           coroutine_stats_table,
+                           ARRAY_SIZE(coroutine_stats_table));
+}
+
+void coroutine_stats_init(void)
+{
+    add_stats_callbacks(STATS_PROVIDER_COROUTINE, coroutine_stats_cb,
+                        coroutine_stats_schemas_cb);
+}
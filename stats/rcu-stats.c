@@ -0,0 +1,54 @@
+/*
+ * RCU callback and grace period statistics for query-stats
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/rcu.h"
+#include "system/stats.h"
+#include "qapi/qapi-commands-stats.h"
+
+static const StatsTableEntry rcu_stats_table[] = {
+    { "pending", STATS_TYPE_INSTANT, false,
+      offsetof(RCUStats, pending) },
+    { "pending-peak", STATS_TYPE_PEAK, false,
+      offsetof(RCUStats, pending_peak) },
+    { "callbacks", STATS_TYPE_CUMULATIVE, false,
+      offsetof(RCUStats, callbacks) },
+    { "grace-periods", STATS_TYPE_CUMULATIVE, false,
+      offsetof(RCUStats, grace_periods) },
+    { "forced-grace-periods", STATS_TYPE_CUMULATIVE, false,
+      offsetof(RCUStats, forced_grace_periods) },
+    { "grace-period-time", STATS_TYPE_CUMULATIVE, true,
+      offsetof(RCUStats, grace_period_ns) },
+    { "grace-period-time-max", STATS_TYPE_PEAK, true,
+      offsetof(RCUStats, grace_period_max_ns) },
+};
+
+static void rcu_stats_cb(StatsResultList **result, StatsTarget target,
+                         strList *names, strList *targets, Error **errp)
+{
+    RCUStats rcu_stats;
+
+    if (target != STATS_TARGET_VM) {
+        return;
+    }
+
+    rcu_get_stats(&rcu_stats);
+    add_stats_table_entry(result, STATS_PROVIDER_RCU, rcu_stats_table,
+                          ARRAY_SIZE(rcu_stats_table), &rcu_stats, names);
+}
+
+static void rcu_stats_schemas_cb(StatsSchemaList **result, Error **errp)
+{
+    add_stats_table_schema(result, STATS_PROVIDER_RCU, rcu_stats_table,
+                           ARRAY_SIZE(rcu_stats_table));
+}
+
+void rcu_stats_init(void)
+{
+    add_stats_callbacks(STATS_PROVIDER_RCU, rcu_stats_cb,
+                        rcu_stats_schemas_cb);
+}
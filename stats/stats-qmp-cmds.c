@@ -162,3 +162,55 @@ bool apply_str_list_filter(const char *string, strList *list)
     }
     return false;
 }
+
+void add_stats_table_entry(StatsResultList **stats_results,
+                           StatsProvider provider,
+                           const StatsTableEntry *table, size_t n,
+                           const void *data, strList *names)
+{
+    StatsList *stats_list = NULL;
+
+    for (size_t i = n; i-- > 0;) {
+        Stats *stats;
+
+        if (!apply_str_list_filter(table[i].name, names)) {
+            continue;
+        }
+
+        stats = g_new0(Stats, 1);
+        stats->name = g_strdup(table[i].name);
+        stats->value = g_new0(StatsValue, 1);
+        stats->value->type = QTYPE_QNUM;
+        stats->value->u.scalar = *(const uint64_t *)((const char *)data +
+                                                     table[i].offset);
+        QAPI_LIST_PREPEND(stats_list, stats);
+    }
+
+    if (stats_list) {
+        add_stats_entry(stats_results, provider, NULL, stats_list);
+    }
+}
+
+void add_stats_table_schema(StatsSchemaList **schema_results,
+                            StatsProvider provider,
+                            const StatsTableEntry *table, size_t n)
+{
+    StatsSchemaValueList *stats_list = NULL;
+
+    for (size_t i = n; i-- > 0;) {
+        StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+        value->name = g_strdup(table[i].name);
+        value->type = table[i].type;
+        if (table[i].nanoseconds) {
+            value->has_unit = true;
+            value->unit = STATS_UNIT_SECONDS;
+            value->has_base = true;
+            value->base = 10;
+            value->exponent = -9;
+        }
+        QAPI_LIST_PREPEND(stats_list, value);
+    }
+
+    add_stats_schema(schema_results, provider, STATS_TARGET_VM, stats_list);
+}
@@ -23,6 +23,7 @@
 #include "qemu/main-loop.h"
 #include "qemu/qemu-print.h"
 #include "qemu/target-info.h"
+#include "qemu/timer.h"
 #include "qom/object.h"
 #include "trace.h"
 #include "system/physmem.h"
@@ -248,7 +249,7 @@ section_from_flat_range(FlatRange *fr, FlatView *fv)
     };
 }
 
-static bool flatrange_equal(FlatRange *a, FlatRange *b)
+static bool flatrange_equal(const FlatRange *a, const FlatRange *b)
 {
     return a->mr == b->mr
         && addrrange_equal(a->addr, b->addr)
@@ -259,6 +260,22 @@ static bool flatrange_equal(FlatRange *a, FlatRange *b)
         && a->unmergeable == b->unmergeable;
 }
 
+static bool flatview_equal(const FlatView *a, const FlatView *b)
+{
+    unsigned i;
+
+    if (a->nr != b->nr) {
+        return false;
+    }
+    for (i = 0; i < a->nr; i++) {
+        if (!flatrange_equal(&a->ranges[i], &b->ranges[i]) ||
+            a->ranges[i].dirty_log_mask != b->ranges[i].dirty_log_mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
 static FlatView *flatview_new(MemoryRegion *mr_root)
 {
     FlatView *view;
@@ -743,8 +760,15 @@ static MemoryRegion *memory_region_get_flatview_root(MemoryRegion *mr)
     return NULL;
 }
 
-/* Render a memory topology into a list of disjoint absolute ranges. */
-static FlatView *generate_memory_topology(MemoryRegion *mr)
+/*
+ * Render a memory topology into a list of disjoint absolute ranges.
+ *
+ * If the result is identical to @old_view, the previous rendering of the
+ * same root, @old_view is reused together with its dispatch tree, so that
+ * a commit only pays for the address spaces whose topology changed.
+ */
+static FlatView *generate_memory_topology(MemoryRegion *mr,
+                                          FlatView *old_view)
 {
     int i;
     FlatView *view;
@@ -758,6 +782,14 @@ static FlatView *generate_memory_topology(MemoryRegion *mr)
     }
     flatview_simplify(view);
 
+    if (old_view && flatview_equal(view, old_view)) {
+        /* Never published, so it can go away without waiting for RCU */
+        flatview_destroy(view);
+        flatview_ref(old_view);
+        g_hash_table_replace(flat_views, mr, old_view);
+        return old_view;
+    }
+
     view->dispatch = address_space_dispatch_new(view);
     for (i = 0; i < view->nr; i++) {
         MemoryRegionSection mrs =
@@ -1047,7 +1079,7 @@ static void flatviews_init(void)
     flat_views = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
                                        (GDestroyNotify) flatview_unref);
     if (!empty_view) {
-        empty_view = generate_memory_topology(NULL);
+        empty_view = generate_memory_topology(NULL, NULL);
         /* We keep it alive forever in the global variable.  */
         flatview_ref(empty_view);
     } else {
@@ -1058,24 +1090,36 @@ static void flatviews_init(void)
 
 static void flatviews_reset(void)
 {
+    GHashTable *old_views = flat_views;
+    unsigned rendered = 0, reused = 0;
     AddressSpace *as;
 
-    if (flat_views) {
-        g_hash_table_unref(flat_views);
-        flat_views = NULL;
-    }
+    flat_views = NULL;
     flatviews_init();
 
     /* Render unique FVs */
     QTAILQ_FOREACH(as, &address_spaces, address_spaces_link) {
         MemoryRegion *physmr = memory_region_get_flatview_root(as->root);
+        FlatView *old_view = NULL;
 
         if (g_hash_table_lookup(flat_views, physmr)) {
             continue;
         }
 
-        generate_memory_topology(physmr);
+        if (old_views) {
+            old_view = g_hash_table_lookup(old_views, physmr);
+        }
+        if (generate_memory_topology(physmr, old_view) == old_view) {
+            reused++;
+        } else {
+            rendered++;
+        }
     }
+
+    if (old_views) {
+        g_hash_table_unref(old_views);
+    }
+    trace_flatviews_reset(rendered, reused);
 }
 
 static void address_space_set_flatview(AddressSpace *as)
@@ -1087,6 +1131,13 @@ static void address_space_set_flatview(AddressSpace *as)
     assert(new_view);
 
     if (old_view == new_view) {
+        /*
+         * The topology did not change, but listeners that rebuild their
+         * state between begin and commit still expect to see every range.
+         */
+        if (!QTAILQ_EMPTY(&as->listeners)) {
+            address_space_update_topology_pass(as, old_view, new_view, true);
+        }
         return;
     }
 
@@ -1129,7 +1180,7 @@ static void address_space_update_topology(AddressSpace *as)
 
     flatviews_init();
     if (!g_hash_table_lookup(flat_views, physmr)) {
-        generate_memory_topology(physmr);
+        generate_memory_topology(physmr, NULL);
     }
     address_space_set_flatview(as);
 }
@@ -1150,6 +1201,10 @@ void memory_region_transaction_commit(void)
     --memory_region_transaction_depth;
     if (!memory_region_transaction_depth) {
         if (memory_region_update_pending) {
+            bool timed = trace_event_get_state_backends(
+                TRACE_MEMORY_REGION_TRANSACTION_COMMIT);
+            int64_t start = timed ? get_clock() : 0;
+
             flatviews_reset();
 
             MEMORY_LISTENER_CALL_GLOBAL(begin, Forward);
@@ -1161,6 +1216,10 @@ void memory_region_transaction_commit(void)
             memory_region_update_pending = false;
             ioeventfd_update_pending = false;
             MEMORY_LISTENER_CALL_GLOBAL(commit, Forward);
+
+            if (timed) {
+                trace_memory_region_transaction_commit(get_clock() - start);
+            }
         } else if (ioeventfd_update_pending) {
             QTAILQ_FOREACH(as, &address_spaces, address_spaces_link) {
                 address_space_update_ioeventfds(as);
@@ -57,6 +57,7 @@
 #include "system/reset.h"
 #include "system/runstate.h"
 #include "system/runstate-action.h"
+#include "system/stats.h"
 #include "system/system.h"
 #include "system/tpm.h"
 #include "trace.h"
@@ -953,6 +954,8 @@ void qemu_init_subsystems(void)
 
     bdrv_init_with_whitelist();
     socket_init();
+    coroutine_stats_init();
+    rcu_stats_init();
 }
 
 
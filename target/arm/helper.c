@@ -8499,6 +8499,7 @@ void arm_log_exception(CPUState *cs)
             [EXCP_VINMI] = "Virtual IRQ NMI",
             [EXCP_VFNMI] = "Virtual FIQ NMI",
             [EXCP_MON_TRAP] = "Monitor Trap",
+            [EXCP_NATIVE_CALL] = "QEMU intercept of host-native function",
         };
 
         if (idx >= 0 && idx < ARRAY_SIZE(excnames)) {
@@ -24,6 +24,9 @@
 #include "arm_ldst.h"
 #include "semihosting/semihost.h"
 #include "cpregs.h"
+#ifdef CONFIG_LINUX_USER
+#include "user/native-call.h"
+#endif
 
 static TCGv_i64 cpu_X[32];
 static TCGv_i64 cpu_gcspr[4];
@@ -10808,6 +10811,22 @@ static void aarch64_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
     }
 
     s->pc_curr = pc;
+
+#ifdef CONFIG_LINUX_USER
+    /*
+     * Intercept calls to functions that are run natively on the host.
+     * cpu_loop() returns from them by setting pc to x30, which would skip
+     * the pop and check of the Guarded Control Stack that RET does, and
+     * the host code doesn't check MTE allocation tags.  So threads with GCS
+     * enabled or MTE tag checks active keep running the guest code.
+     */
+    if (!s->gcs_en && !s->mte_active[0] && native_call_lookup(pc)) {
+        s->base.pc_next = pc + 4;
+        gen_exception_internal_insn(s, EXCP_NATIVE_CALL);
+        return;
+    }
+#endif
+
     insn = arm_ldl_code(env, &s->base, pc, s->sctlr_b);
     s->insn = insn;
     s->base.pc_next = pc + 4;
@@ -187,6 +187,11 @@ typedef struct {
     uint16_t tag;
 } QEMU_PACKED P9Hdr;
 
+static uint32_t v9fs_msize(QVirtio9P *v9p)
+{
+    return v9p->msize ? v9p->msize : P9_MAX_SIZE;
+}
+
 P9Req *v9fs_req_init(QVirtio9P *v9p, uint32_t size, uint8_t id,
                      uint16_t tag)
 {
@@ -201,7 +206,7 @@ P9Req *v9fs_req_init(QVirtio9P *v9p, uint32_t size, uint8_t id,
     total_size += size;
     hdr.size = cpu_to_le32(total_size);
 
-    g_assert_cmpint(total_size, <=, P9_MAX_SIZE);
+    g_assert_cmpint(total_size, <=, v9fs_msize(v9p));
 
     req->qts = global_qtest;
     req->v9p = v9p;
@@ -216,10 +221,11 @@ void v9fs_req_send(P9Req *req)
 {
     QVirtio9P *v9p = req->v9p;
 
-    req->r_msg = guest_alloc(alloc, P9_MAX_SIZE);
+    req->r_size = v9fs_msize(v9p);
+    req->r_msg = guest_alloc(alloc, req->r_size);
     req->free_head = qvirtqueue_add(req->qts, v9p->vq, req->t_msg, req->t_size,
                                     false, true);
-    qvirtqueue_add(req->qts, v9p->vq, req->r_msg, P9_MAX_SIZE, true, false);
+    qvirtqueue_add(req->qts, v9p->vq, req->r_msg, req->r_size, true, false);
     qvirtqueue_kick(req->qts, v9p->vdev, v9p->vq, req->free_head);
     req->t_off = 0;
 }
@@ -232,6 +238,7 @@ static const char *rmessage_name(uint8_t id)
         id == P9_RATTACH ? "RATTACH" :
         id == P9_RWALK ? "RWALK" :
         id == P9_RLOPEN ? "RLOPEN" :
+        id == P9_RREAD ? "RREAD" :
         id == P9_RWRITE ? "RWRITE" :
         id == P9_RMKDIR ? "RMKDIR" :
         id == P9_RLCREATE ? "RLCREATE" :
@@ -261,7 +268,7 @@ void v9fs_req_recv(P9Req *req, uint8_t id)
     hdr.tag = lduw_le_p(&hdr.tag);
 
     g_assert_cmpint(hdr.size, >=, 7);
-    g_assert_cmpint(hdr.size, <=, P9_MAX_SIZE);
+    g_assert_cmpint(hdr.size, <=, req->r_size);
     g_assert_cmpint(hdr.tag, ==, req->tag);
 
     if (hdr.id != id) {
@@ -320,6 +327,8 @@ TVersionRes v9fs_tversion(TVersionOpt opt)
     g_assert_cmpint(body_size, <=, UINT32_MAX - string_size);
     body_size += string_size;
     req = v9fs_req_init(opt.client, body_size, P9_TVERSION, opt.tag);
+    /* the reply and all later messages may use the new msize */
+    opt.client->msize = opt.msize;
 
     v9fs_uint32_write(req, opt.msize);
     v9fs_string_write(req, opt.version);
@@ -351,7 +360,7 @@ void v9fs_rversion(P9Req *req, uint16_t *len, char **version)
     v9fs_req_recv(req, P9_RVERSION);
     v9fs_uint32_read(req, &msize);
 
-    g_assert_cmpint(msize, ==, P9_MAX_SIZE);
+    g_assert_cmpint(msize, ==, v9fs_msize(req->v9p));
 
     if (len || version) {
         v9fs_string_read(req, len, version);
@@ -372,7 +381,9 @@ TAttachRes v9fs_tattach(TAttachOpt opt)
     g_assert(!opt.expectErr || !opt.rattach.qid);
 
     if (!opt.requestOnly) {
-        v9fs_tversion((TVersionOpt) { .client = opt.client });
+        v9fs_tversion((TVersionOpt) {
+            .client = opt.client, .msize = opt.msize
+        });
     }
 
     if (!opt.n_uname) {
@@ -742,6 +753,57 @@ void v9fs_rlopen(P9Req *req, v9fs_qid *qid, uint32_t *iounit)
     v9fs_req_free(req);
 }
 
+/* size[4] Tread tag[2] fid[4] offset[8] count[4] */
+TReadRes v9fs_tread(TReadOpt opt)
+{
+    P9Req *req;
+    uint32_t err;
+    uint32_t count = 0;
+
+    g_assert(opt.client);
+    /* expecting either Rread or Rlerror, but obviously not both */
+    g_assert(!opt.expectErr || !opt.data);
+
+    req = v9fs_req_init(opt.client, 4 + 8 + 4, P9_TREAD, opt.tag);
+    v9fs_uint32_write(req, opt.fid);
+    v9fs_uint64_write(req, opt.offset);
+    v9fs_uint32_write(req, opt.count);
+    v9fs_req_send(req);
+
+    if (!opt.requestOnly) {
+        v9fs_req_wait_for_reply(req, NULL);
+        if (opt.expectErr) {
+            v9fs_rlerror(req, &err);
+            g_assert_cmpint(err, ==, opt.expectErr);
+        } else {
+            v9fs_rread(req, &count, opt.data);
+            g_assert_cmpint(count, <=, opt.count);
+        }
+        req = NULL; /* request was freed */
+    }
+
+    return (TReadRes) {
+        .req = req,
+        .count = count
+    };
+}
+
+/* size[4] Rread tag[2] count[4] data[count] */
+void v9fs_rread(P9Req *req, uint32_t *count, void *data)
+{
+    uint32_t local_count;
+
+    v9fs_req_recv(req, P9_RREAD);
+    v9fs_uint32_read(req, &local_count);
+    if (count) {
+        *count = local_count;
+    }
+    if (data) {
+        v9fs_memread(req, data, local_count);
+    }
+    v9fs_req_free(req);
+}
+
 /* size[4] Twrite tag[2] fid[4] offset[8] count[4] data[count] */
 TWriteRes v9fs_twrite(TWriteOpt opt)
 {
@@ -1103,3 +1165,63 @@ void v9fs_runlinkat(P9Req *req)
     v9fs_req_recv(req, P9_RUNLINKAT);
     v9fs_req_free(req);
 }
+
+/*
+ * size[4] Trenameat tag[2] olddirfid[4] oldname[s] newdirfid[4] newname[s]
+ */
+TrenameatRes v9fs_trenameat(TrenameatOpt opt)
+{
+    P9Req *req;
+    uint32_t err;
+
+    g_assert(opt.client);
+    /* expecting either hi-level oldAtPath or low-level olddirfid */
+    g_assert(!opt.oldAtPath || !opt.olddirfid);
+    /* expecting either hi-level newAtPath or low-level newdirfid */
+    g_assert(!opt.newAtPath || !opt.newdirfid);
+
+    if (opt.oldAtPath) {
+        opt.olddirfid = v9fs_twalk((TWalkOpt) { .client = opt.client,
+                                                .path = opt.oldAtPath }).newfid;
+    }
+    if (opt.newAtPath) {
+        opt.newdirfid = v9fs_twalk((TWalkOpt) { .client = opt.client,
+                                                .path = opt.newAtPath }).newfid;
+    }
+
+    uint32_t body_size = 4 + 4;
+    uint16_t string_size = v9fs_string_size(opt.oldname);
+
+    g_assert_cmpint(body_size, <=, UINT32_MAX - string_size);
+    body_size += string_size;
+    string_size = v9fs_string_size(opt.newname);
+    g_assert_cmpint(body_size, <=, UINT32_MAX - string_size);
+    body_size += string_size;
+
+    req = v9fs_req_init(opt.client, body_size, P9_TRENAMEAT, opt.tag);
+    v9fs_uint32_write(req, opt.olddirfid);
+    v9fs_string_write(req, opt.oldname);
+    v9fs_uint32_write(req, opt.newdirfid);
+    v9fs_string_write(req, opt.newname);
+    v9fs_req_send(req);
+
+    if (!opt.requestOnly) {
+        v9fs_req_wait_for_reply(req, NULL);
+        if (opt.expectErr) {
+            v9fs_rlerror(req, &err);
+            g_assert_cmpint(err, ==, opt.expectErr);
+        } else {
+            v9fs_rrenameat(req);
+        }
+        req = NULL; /* request was freed */
+    }
+
+    return (TrenameatRes) { .req = req };
+}
+
+/* size[4] Rrenameat tag[2] */
+void v9fs_rrenameat(P9Req *req)
+{
+    v9fs_req_recv(req, P9_RRENAMEAT);
+    v9fs_req_free(req);
+}
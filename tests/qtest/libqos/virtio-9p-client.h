@@ -21,7 +21,7 @@
 #include "qgraph.h"
 #include "tests/qtest/libqtest-single.h"
 
-#define P9_MAX_SIZE 4096 /* Max size of a T-message or R-message */
+#define P9_MAX_SIZE 4096 /* Default max size of a T-message or R-message */
 
 typedef struct {
     QTestState *qts;
@@ -30,7 +30,7 @@ typedef struct {
     uint64_t t_msg;
     uint32_t t_size;
     uint64_t r_msg;
-    /* No r_size, it is hardcoded to P9_MAX_SIZE */
+    uint32_t r_size;
     size_t t_off;
     size_t r_off;
     uint32_t free_head;
@@ -149,6 +149,8 @@ typedef struct TAttachOpt {
     uint32_t fid;
     /* numerical uid of user being introduced to server (optional) */
     uint32_t n_uname;
+    /* msize for the preceding Tversion request (optional) */
+    uint32_t msize;
     /* data being received from 9p server as 'Rattach' response (optional) */
     struct {
         /* server's idea of the root of the file tree */
@@ -271,6 +273,34 @@ typedef struct TLOpenRes {
     P9Req *req;
 } TLOpenRes;
 
+/* options for 'Tread' 9p request */
+typedef struct TReadOpt {
+    /* 9P client being used (mandatory) */
+    QVirtio9P *client;
+    /* user supplied tag number being returned with response (optional) */
+    uint16_t tag;
+    /* file ID of file to read from (required) */
+    uint32_t fid;
+    /* start position of read from beginning of file (optional) */
+    uint64_t offset;
+    /* how many bytes to read */
+    uint32_t count;
+    /* buffer for the data being read (required) */
+    void *data;
+    /* only send Tread request but not wait for a reply? (optional) */
+    bool requestOnly;
+    /* do we expect an Rlerror response, if yes which error code? (optional) */
+    uint32_t expectErr;
+} TReadOpt;
+
+/* result of 'Tread' 9p request */
+typedef struct TReadRes {
+    /* if requestOnly was set: request object for further processing */
+    P9Req *req;
+    /* amount of bytes read */
+    uint32_t count;
+} TReadRes;
+
 /* options for 'Twrite' 9p request */
 typedef struct TWriteOpt {
     /* 9P client being used (mandatory) */
@@ -473,6 +503,36 @@ typedef struct TunlinkatRes {
     P9Req *req;
 } TunlinkatRes;
 
+/* options for 'Trenameat' 9p request */
+typedef struct TrenameatOpt {
+    /* 9P client being used (mandatory) */
+    QVirtio9P *client;
+    /* user supplied tag number being returned with response (optional) */
+    uint16_t tag;
+    /* low-level variant of directory containing the entry to be renamed */
+    uint32_t olddirfid;
+    /* high-level variant of directory containing the entry to be renamed */
+    const char *oldAtPath;
+    /* name of directory entry to be renamed (required) */
+    const char *oldname;
+    /* low-level variant of directory the entry shall be moved to */
+    uint32_t newdirfid;
+    /* high-level variant of directory the entry shall be moved to */
+    const char *newAtPath;
+    /* new name of directory entry (required) */
+    const char *newname;
+    /* only send Trenameat request but not wait for a reply? (optional) */
+    bool requestOnly;
+    /* do we expect an Rlerror response, if yes which error code? (optional) */
+    uint32_t expectErr;
+} TrenameatOpt;
+
+/* result of 'Trenameat' 9p request */
+typedef struct TrenameatRes {
+    /* if requestOnly was set: request object for further processing */
+    P9Req *req;
+} TrenameatRes;
+
 void v9fs_set_allocator(QGuestAllocator *t_alloc);
 void v9fs_memwrite(P9Req *req, const void *addr, size_t len);
 void v9fs_memskip(P9Req *req, size_t len);
@@ -510,6 +570,8 @@ void v9fs_rreaddir(P9Req *req, uint32_t *count, uint32_t *nentries,
 void v9fs_free_dirents(struct V9fsDirent *e);
 TLOpenRes v9fs_tlopen(TLOpenOpt);
 void v9fs_rlopen(P9Req *req, v9fs_qid *qid, uint32_t *iounit);
+TReadRes v9fs_tread(TReadOpt);
+void v9fs_rread(P9Req *req, uint32_t *count, void *data);
 TWriteRes v9fs_twrite(TWriteOpt);
 void v9fs_rwrite(P9Req *req, uint32_t *count);
 TFlushRes v9fs_tflush(TFlushOpt);
@@ -524,5 +586,7 @@ TlinkRes v9fs_tlink(TlinkOpt);
 void v9fs_rlink(P9Req *req);
 TunlinkatRes v9fs_tunlinkat(TunlinkatOpt);
 void v9fs_runlinkat(P9Req *req);
+TrenameatRes v9fs_trenameat(TrenameatOpt);
+void v9fs_rrenameat(P9Req *req);
 
 #endif
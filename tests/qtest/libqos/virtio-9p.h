@@ -32,6 +32,8 @@ typedef struct QVirtio9PDevice QVirtio9PDevice;
 struct QVirtio9P {
     QVirtioDevice *vdev;
     QVirtQueue *vq;
+    /* msize of the last Tversion, 0 for P9_MAX_SIZE */
+    uint32_t msize;
 };
 
 struct QVirtio9PPCI {
@@ -324,6 +324,71 @@ static void test_qmp_preconfig(void)
     qtest_quit(qs);
 }
 
+/*
+ * Check the phases that query-startup-timeline returns: they start with
+ * no-machine at 0 and follow each other in order, and each phase but the
+ * current one has a duration that ends where the next phase starts.
+ * Return the number of phases.
+ */
+static int check_startup_phases(QTestState *qs, const char *last_phase)
+{
+    static const char *const phases[] = {
+        "no-machine", "machine-created", "accel-created",
+        "late-backends-created", "machine-initialized", "machine-ready",
+    };
+    QDict *rsp, *ret;
+    QList *list;
+    QListEntry *entry;
+    int64_t next_start = 0;
+    int n = 0;
+
+    rsp = qtest_qmp(qs, "{ 'execute': 'query-startup-timeline' }");
+    ret = qdict_get_qdict(rsp, "return");
+    g_assert(ret);
+    g_assert(qdict_haskey(ret, "devices"));
+    list = qdict_get_qlist(ret, "phases");
+    g_assert(list);
+
+    QLIST_FOREACH_ENTRY(list, entry) {
+        QDict *info = qobject_to(QDict, qlist_entry_obj(entry));
+        bool last;
+
+        g_assert(info);
+        g_assert_cmpint(n, <, ARRAY_SIZE(phases));
+        g_assert_cmpstr(qdict_get_str(info, "phase"), ==, phases[n]);
+        g_assert_cmpint(qdict_get_int(info, "start-ns"), ==, next_start);
+
+        last = !qlist_next(entry);
+        g_assert(qdict_haskey(info, "duration-ns") == !last);
+        if (!last) {
+            g_assert_cmpint(qdict_get_int(info, "duration-ns"), >=, 0);
+            next_start += qdict_get_int(info, "duration-ns");
+        }
+        n++;
+    }
+    g_assert_cmpint(n, >, 0);
+    g_assert_cmpstr(phases[n - 1], ==, last_phase);
+
+    qobject_unref(rsp);
+    return n;
+}
+
+static void test_qmp_startup_timeline(void)
+{
+    QTestState *qs = qtest_initf("%s --preconfig", common_args);
+    int n;
+
+    /* The board is only initialized when leaving preconfig state */
+    n = check_startup_phases(qs, "late-backends-created");
+
+    g_assert(!qmp_rsp_is_err(qtest_qmp(qs, "{ 'execute': 'x-exit-preconfig' }")));
+    qtest_qmp_eventwait(qs, "RESUME");
+
+    g_assert_cmpint(check_startup_phases(qs, "machine-ready"), >, n);
+
+    qtest_quit(qs);
+}
+
 static void test_qmp_missing_any_arg(void)
 {
     QTestState *qts;
@@ -347,6 +412,7 @@ int main(int argc, char *argv[])
     qtest_add_func("qmp/oob", test_qmp_oob);
 #endif
     qtest_add_func("qmp/preconfig", test_qmp_preconfig);
+    qtest_add_func("qmp/startup-timeline", test_qmp_startup_timeline);
     qtest_add_func("qmp/missing-any-arg", test_qmp_missing_any_arg);
 
     return g_test_run();
@@ -0,0 +1,229 @@
+/*
+ * QTest test cases for the query-stats providers of the QEMU process
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qobject/qdict.h"
+#include "qobject/qlist.h"
+
+typedef struct StatsSchemaCheck {
+    const char *name;
+    const char *type;
+    bool nanoseconds;
+} StatsSchemaCheck;
+
+static const StatsSchemaCheck coroutine_schema[] = {
+    { "pool-hits", "cumulative" },
+    { "pool-misses", "cumulative" },
+    { "allocated", "instant" },
+    { "allocated-peak", "peak" },
+    { "global-pool-size", "instant" },
+};
+
+static const StatsSchemaCheck rcu_schema[] = {
+    { "pending", "instant" },
+    { "pending-peak", "peak" },
+    { "callbacks", "cumulative" },
+    { "grace-periods", "cumulative" },
+    { "forced-grace-periods", "cumulative" },
+    { "grace-period-time", "cumulative", true },
+    { "grace-period-time-max", "peak", true },
+};
+
+static void check_schema(QTestState *qts, const char *provider,
+                         const StatsSchemaCheck *expected, int n)
+{
+    QDict *rsp, *schema;
+    QList *list;
+    QListEntry *entry;
+    int i = 0;
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'query-stats-schemas',"
+                    "  'arguments': { 'provider': %s } }", provider);
+    list = qdict_get_qlist(rsp, "return");
+    g_assert(list);
+    g_assert_cmpint(qlist_size(list), ==, 1);
+
+    schema = qobject_to(QDict, qlist_peek(list));
+    g_assert_cmpstr(qdict_get_str(schema, "provider"), ==, provider);
+    g_assert_cmpstr(qdict_get_str(schema, "target"), ==, "vm");
+
+    QLIST_FOREACH_ENTRY(qdict_get_qlist(schema, "stats"), entry) {
+        QDict *value = qobject_to(QDict, qlist_entry_obj(entry));
+
+        g_assert_cmpint(i, <, n);
+        g_assert_cmpstr(qdict_get_str(value, "name"), ==, expected[i].name);
+        g_assert_cmpstr(qdict_get_str(value, "type"), ==, expected[i].type);
+        if (expected[i].nanoseconds) {
+            g_assert_cmpstr(qdict_get_str(value, "unit"), ==, "seconds");
+            g_assert_cmpint(qdict_get_int(value, "base"), ==, 10);
+            g_assert_cmpint(qdict_get_int(value, "exponent"), ==, -9);
+        } else {
+            g_assert(!qdict_haskey(value, "unit"));
+        }
+        i++;
+    }
+    g_assert_cmpint(i, ==, n);
+
+    qobject_unref(rsp);
+}
+
+/*
+ * Return the statistics of @provider as a dictionary from their names to
+ * their values.  If @name is not NULL, request only that statistic.
+ */
+static QDict *query_stats(QTestState *qts, const char *provider,
+                          const char *name)
+{
+    QDict *rsp, *result, *values;
+    QList *list;
+    QListEntry *entry;
+
+    if (name) {
+        rsp = qtest_qmp(qts, "{ 'execute': 'query-stats', 'arguments': {"
+                        "  'target': 'vm', 'providers': [ {"
+                        "    'provider': %s, 'names': [ %s ] } ] } }",
+                        provider, name);
+    } else {
+        rsp = qtest_qmp(qts, "{ 'execute': 'query-stats', 'arguments': {"
+                        "  'target': 'vm', 'providers': [ {"
+                        "    'provider': %s } ] } }",
+                        provider);
+    }
+    list = qdict_get_qlist(rsp, "return");
+    g_assert(list);
+    g_assert_cmpint(qlist_size(list), ==, 1);
+
+    result = qobject_to(QDict, qlist_peek(list));
+    g_assert_cmpstr(qdict_get_str(result, "provider"), ==, provider);
+
+    values = qdict_new();
+    QLIST_FOREACH_ENTRY(qdict_get_qlist(result, "stats"), entry) {
+        QDict *stat = qobject_to(QDict, qlist_entry_obj(entry));
+
+        qdict_put_int(values, qdict_get_str(stat, "name"),
+                      qdict_get_int(stat, "value"));
+    }
+
+    qobject_unref(rsp);
+    return values;
+}
+
+/* Check that query-stats returns exactly the statistics in the schema */
+static QDict *query_all_stats(QTestState *qts, const char *provider,
+                              const StatsSchemaCheck *expected, int n)
+{
+    QDict *values = query_stats(qts, provider, NULL);
+    int i;
+
+    g_assert_cmpint(qdict_size(values), ==, n);
+    for (i = 0; i < n; i++) {
+        g_assert(qdict_haskey(values, expected[i].name));
+    }
+
+    return values;
+}
+
+static void test_coroutine_stats(void)
+{
+    QTestState *qts;
+    QDict *rsp, *before, *after;
+
+    qts = qtest_init("-machine none -object iothread,id=iothread0");
+
+    /* The pool size of an iothread can be changed at runtime */
+    qtest_qmp_assert_success(qts, "{ 'execute': 'qom-set', 'arguments': {"
+                             "  'path': '/objects/iothread0',"
+                             "  'property': 'coroutine-pool-size',"
+                             "  'value': 16 } }");
+    rsp = qtest_qmp(qts, "{ 'execute': 'qom-set', 'arguments': {"
+                    "  'path': '/objects/iothread0',"
+                    "  'property': 'coroutine-pool-size',"
+                    "  'value': 4294967296 } }");
+    qmp_expect_error_and_unref(rsp, "GenericError");
+    rsp = qtest_qmp(qts, "{ 'execute': 'qom-get', 'arguments': {"
+                    "  'path': '/objects/iothread0',"
+                    "  'property': 'coroutine-pool-size' } }");
+    g_assert_cmpint(qdict_get_int(rsp, "return"), ==, 16);
+    qobject_unref(rsp);
+
+    check_schema(qts, "coroutine", coroutine_schema,
+                 ARRAY_SIZE(coroutine_schema));
+
+    /*
+     * Coroutines are counted in allocated before allocated-peak is raised,
+     * so only compare each statistic with its own earlier value
+     */
+    before = query_all_stats(qts, "coroutine", coroutine_schema,
+                             ARRAY_SIZE(coroutine_schema));
+
+    after = query_all_stats(qts, "coroutine", coroutine_schema,
+                            ARRAY_SIZE(coroutine_schema));
+    g_assert_cmpint(qdict_get_int(after, "pool-hits"), >=,
+                    qdict_get_int(before, "pool-hits"));
+    g_assert_cmpint(qdict_get_int(after, "pool-misses"), >=,
+                    qdict_get_int(before, "pool-misses"));
+    g_assert_cmpint(qdict_get_int(after, "allocated-peak"), >=,
+                    qdict_get_int(before, "allocated-peak"));
+    qobject_unref(before);
+    qobject_unref(after);
+
+    /* Only the requested statistics are returned */
+    after = query_stats(qts, "coroutine", "allocated");
+    g_assert_cmpint(qdict_size(after), ==, 1);
+    g_assert(qdict_haskey(after, "allocated"));
+    qobject_unref(after);
+
+    qtest_quit(qts);
+}
+
+static void test_rcu_stats(void)
+{
+    QTestState *qts;
+    QDict *before, *after;
+
+    qts = qtest_init("-machine none");
+
+    check_schema(qts, "rcu", rcu_schema, ARRAY_SIZE(rcu_schema));
+
+    /*
+     * The call_rcu thread updates the statistics one by one, so only
+     * check that each of them doesn't go down
+     */
+    before = query_all_stats(qts, "rcu", rcu_schema, ARRAY_SIZE(rcu_schema));
+    after = query_all_stats(qts, "rcu", rcu_schema, ARRAY_SIZE(rcu_schema));
+    g_assert_cmpint(qdict_get_int(after, "callbacks"), >=,
+                    qdict_get_int(before, "callbacks"));
+    g_assert_cmpint(qdict_get_int(after, "grace-periods"), >=,
+                    qdict_get_int(before, "grace-periods"));
+    g_assert_cmpint(qdict_get_int(after, "forced-grace-periods"), >=,
+                    qdict_get_int(before, "forced-grace-periods"));
+    g_assert_cmpint(qdict_get_int(after, "grace-period-time"), >=,
+                    qdict_get_int(before, "grace-period-time"));
+    g_assert_cmpint(qdict_get_int(after, "grace-period-time-max"), >=,
+                    qdict_get_int(before, "grace-period-time-max"));
+    g_assert_cmpint(qdict_get_int(after, "pending-peak"), >=,
+                    qdict_get_int(before, "pending-peak"));
+    qobject_unref(before);
+    qobject_unref(after);
+
+    after = query_stats(qts, "rcu", "grace-periods");
+    g_assert_cmpint(qdict_size(after), ==, 1);
+    g_assert(qdict_haskey(after, "grace-periods"));
+    qobject_unref(after);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("stats/coroutine", test_coroutine_stats);
+    qtest_add_func("stats/rcu", test_rcu_stats);
+
+    return g_test_run();
+}
@@ -764,6 +764,84 @@ static void multiqueue(void *obj, void *data, QGuestAllocator *t_alloc)
     qpci_unplug_acpi_device_test(qts, "drv1", PCI_SLOT_HP);
 }
 
+/*
+ * Disconnect while requests are in flight on virtqueues that the export
+ * processes in different iothreads.  qemu-storage-daemon must wait for all of
+ * them before it unmaps guest memory, and must not crash or hang doing so;
+ * quit_storage_daemon() checks that it still exits successfully.
+ */
+static void disconnect_in_flight(void *obj, void *data,
+                                 QGuestAllocator *t_alloc)
+{
+    QVirtioPCIDevice *pdev1 = obj;
+    QVirtioPCIDevice *pdev8;
+    QVirtioDevice *dev8;
+    QTestState *qts = pdev1->pdev->bus->qts;
+    QVirtQueue *vqs[8];
+    uint64_t features;
+    int i, j;
+
+    if (pdev1->pdev->bus->not_hotpluggable) {
+        g_test_skip("bus pci.0 does not support hotplug");
+        return;
+    }
+
+    /* Hotplug a secondary device with 8 queues, spread over 4 iothreads */
+    qtest_qmp_device_add(qts, "vhost-user-blk-pci", "drv1",
+                         "{'addr': %s, 'chardev': 'char2', 'num-queues': 8}",
+                         stringify(PCI_SLOT_HP) ".0");
+
+    pdev8 = virtio_pci_new(pdev1->pdev->bus,
+                           &(QPCIAddress) {
+                               .devfn = QPCI_DEVFN(PCI_SLOT_HP, 0)
+                           });
+    g_assert_nonnull(pdev8);
+    qos_object_start_hw(&pdev8->obj);
+
+    dev8 = &pdev8->vdev;
+    features = qvirtio_get_features(dev8);
+    features = features & ~(QVIRTIO_F_BAD_FEATURE |
+                            (1u << VIRTIO_RING_F_INDIRECT_DESC) |
+                            (1u << VIRTIO_RING_F_EVENT_IDX) |
+                            (1u << VIRTIO_BLK_F_SCSI));
+    qvirtio_set_features(dev8, features);
+
+    for (i = 0; i < ARRAY_SIZE(vqs); i++) {
+        vqs[i] = qvirtqueue_setup(dev8, t_alloc, i);
+    }
+    qvirtio_set_driver_ok(dev8);
+
+    for (i = 0; i < ARRAY_SIZE(vqs); i++) {
+        for (j = 0; j < 8; j++) {
+            QVirtioBlkReq req;
+            uint64_t req_addr;
+            uint32_t free_head;
+
+            req.type = VIRTIO_BLK_T_OUT;
+            req.ioprio = 1;
+            req.sector = i * 8 + j;
+            req.data = g_malloc0(512);
+            strcpy(req.data, "TEST");
+
+            req_addr = virtio_blk_request(t_alloc, dev8, &req, 512);
+
+            g_free(req.data);
+
+            free_head = qvirtqueue_add(qts, vqs[i], req_addr, 16, false, true);
+            qvirtqueue_add(qts, vqs[i], req_addr + 16, 512, false, true);
+            qvirtqueue_add(qts, vqs[i], req_addr + 528, 1, true, false);
+
+            qvirtqueue_kick(qts, dev8, vqs[i], free_head);
+        }
+    }
+
+    /*
+     * Don't wait for any of the requests: killing QEMU closes the vhost-user
+     * connection while they are still being processed.
+     */
+    qtest_kill_qemu(qts);
+}
+
 /*
  * Check that setting the vring addr on a non-existent virtqueue does
  * not crash.
@@ -893,7 +971,7 @@ static void quit_storage_daemon(void *data)
 }
 
 static void start_vhost_user_blk(GString *cmd_line, int vus_instances,
-                                 int num_queues)
+                                 int num_queues, int num_iothreads)
 {
     const char *vhost_user_blk_bin = qtest_qemu_storage_daemon_binary();
     int i;
@@ -909,8 +987,14 @@ static void start_vhost_user_blk(GString *cmd_line, int vus_instances,
             " -object memory-backend-shm,id=mem,size=256M "
             " -M memory-backend=mem -m 256M ");
 
+    for (i = 0; i < num_iothreads; i++) {
+        g_string_append_printf(storage_daemon_command,
+                               "--object iothread,id=iothread%d ", i);
+    }
+
     for (i = 0; i < vus_instances; i++) {
         int fd;
+        int j;
         char *sock_path = create_listen_socket(&fd);
 
         /* create image file */
@@ -918,8 +1002,13 @@ static void start_vhost_user_blk(GString *cmd_line, int vus_instances,
         g_string_append_printf(storage_daemon_command,
             "--blockdev driver=file,node-name=disk%d,filename=%s "
             "--export type=vhost-user-blk,id=disk%d,addr.type=fd,addr.str=%d,"
-            "node-name=disk%i,writable=on,num-queues=%d ",
+            "node-name=disk%i,writable=on,num-queues=%d",
             i, img_path, i, fd, i, num_queues);
+        for (j = 0; j < num_iothreads; j++) {
+            g_string_append_printf(storage_daemon_command,
+                                   ",iothread.%d=iothread%d", j, j);
+        }
+        g_string_append_c(storage_daemon_command, ' ');
 
         g_string_append_printf(cmd_line, "-chardev socket,id=char%d,path=%s ",
                                i + 1, sock_path);
@@ -953,7 +1042,7 @@ static void start_vhost_user_blk(GString *cmd_line, int vus_instances,
 
 static void *vhost_user_blk_test_setup(GString *cmd_line, void *arg)
 {
-    start_vhost_user_blk(cmd_line, 1, 1);
+    start_vhost_user_blk(cmd_line, 1, 1, 0);
     return arg;
 }
 
@@ -967,13 +1056,19 @@ static void *vhost_user_blk_test_setup(GString *cmd_line, void *arg)
 static void *vhost_user_blk_hotplug_test_setup(GString *cmd_line, void *arg)
 {
     /* "-chardev socket,id=char2" is used for pci_hotplug*/
-    start_vhost_user_blk(cmd_line, 2, 1);
+    start_vhost_user_blk(cmd_line, 2, 1, 0);
     return arg;
 }
 
 static void *vhost_user_blk_multiqueue_test_setup(GString *cmd_line, void *arg)
 {
-    start_vhost_user_blk(cmd_line, 2, 8);
+    start_vhost_user_blk(cmd_line, 2, 8, 0);
+    return arg;
+}
+
+static void *vhost_user_blk_iothreads_test_setup(GString *cmd_line, void *arg)
+{
+    start_vhost_user_blk(cmd_line, 2, 8, 4);
     return arg;
 }
 
@@ -1009,6 +1104,10 @@ static void register_vhost_user_blk_test(void)
 
     opts.before = vhost_user_blk_multiqueue_test_setup;
     qos_add_test("multiqueue", "vhost-user-blk-pci", multiqueue, &opts);
+
+    opts.before = vhost_user_blk_iothreads_test_setup;
+    qos_add_test("disconnect-in-flight", "vhost-user-blk-pci",
+                 disconnect_in_flight, &opts);
 }
 
 libqos_init(register_vhost_user_blk_test);
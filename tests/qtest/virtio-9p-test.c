@@ -23,6 +23,7 @@
 #define tsetattr(...) v9fs_tsetattr((TSetAttrOpt) __VA_ARGS__)
 #define treaddir(...) v9fs_treaddir((TReadDirOpt) __VA_ARGS__)
 #define tlopen(...) v9fs_tlopen((TLOpenOpt) __VA_ARGS__)
+#define tread(...) v9fs_tread((TReadOpt) __VA_ARGS__)
 #define twrite(...) v9fs_twrite((TWriteOpt) __VA_ARGS__)
 #define tflush(...) v9fs_tflush((TFlushOpt) __VA_ARGS__)
 #define tmkdir(...) v9fs_tmkdir((TMkdirOpt) __VA_ARGS__)
@@ -30,6 +31,7 @@
 #define tsymlink(...) v9fs_tsymlink((TsymlinkOpt) __VA_ARGS__)
 #define tlink(...) v9fs_tlink((TlinkOpt) __VA_ARGS__)
 #define tunlinkat(...) v9fs_tunlinkat((TunlinkatOpt) __VA_ARGS__)
+#define trenameat(...) v9fs_trenameat((TrenameatOpt) __VA_ARGS__)
 
 static void pci_config(void *obj, void *data, QGuestAllocator *t_alloc)
 {
@@ -752,6 +754,163 @@ static void fs_use_after_unlink(void *obj, void *data,
     g_assert_cmpint(attr.size, ==, 2001);
 }
 
+static void fs_readwrite_large(void *obj, void *data,
+                               QGuestAllocator *t_alloc)
+{
+    QVirtio9P *v9p = obj;
+    v9fs_set_allocator(t_alloc);
+    /* large enough for the server to split it into several chunks */
+    static const uint32_t rw_count = 512 * 1024;
+    g_autofree char *real_file = virtio_9p_test_path("13/large_file");
+    g_autofree char *wbuf = g_malloc(rw_count);
+    g_autofree char *rbuf = g_malloc0(rw_count);
+    g_autofree char *contents = NULL;
+    gsize length;
+    uint32_t fid_file;
+    uint32_t count;
+    uint32_t i;
+
+    for (i = 0; i < rw_count; i++) {
+        wbuf[i] = i % 251;
+    }
+
+    tattach({ .client = v9p, .msize = rw_count + P9_MAX_SIZE });
+    tmkdir({ .client = v9p, .atPath = "/", .name = "13" });
+    tlcreate({ .client = v9p, .atPath = "13", .name = "large_file" });
+
+    fid_file = twalk({ .client = v9p, .path = "13/large_file" }).newfid;
+    tlopen({ .client = v9p, .fid = fid_file, .flags = O_RDWR });
+
+    count = twrite({
+        .client = v9p, .fid = fid_file, .offset = 0, .count = rw_count,
+        .data = wbuf
+    }).count;
+    g_assert_cmpint(count, ==, rw_count);
+
+    g_assert(g_file_get_contents(real_file, &contents, &length, NULL));
+    g_assert_cmpint(length, ==, rw_count);
+    g_assert(memcmp(contents, wbuf, rw_count) == 0);
+
+    count = tread({
+        .client = v9p, .fid = fid_file, .offset = 0, .count = rw_count,
+        .data = rbuf
+    }).count;
+    g_assert_cmpint(count, ==, rw_count);
+    g_assert(memcmp(rbuf, wbuf, rw_count) == 0);
+
+    /* a read crossing EOF must return exactly the data up to EOF */
+    memset(rbuf, 0, rw_count);
+    count = tread({
+        .client = v9p, .fid = fid_file, .offset = rw_count / 2 + 1,
+        .count = rw_count, .data = rbuf
+    }).count;
+    g_assert_cmpint(count, ==, rw_count / 2 - 1);
+    g_assert(memcmp(rbuf, wbuf + rw_count / 2 + 1, count) == 0);
+}
+
+/* tests for the metadata cache of the 'local' fs driver (cache=loose) */
+
+static void fs_cache_negative_entry(void *obj, void *data,
+                                    QGuestAllocator *t_alloc)
+{
+    QVirtio9P *v9p = obj;
+    v9fs_set_allocator(t_alloc);
+
+    tattach({ .client = v9p });
+    tmkdir({ .client = v9p, .atPath = "/", .name = "10" });
+
+    /* cache a negative entry for "10/new_file" ... */
+    twalk({ .client = v9p, .path = "10/new_file", .expectErr = ENOENT });
+
+    /* ... which must not hide the file once it has been created */
+    tlcreate({ .client = v9p, .atPath = "10", .name = "new_file" });
+    twalk({ .client = v9p, .path = "10/new_file" });
+}
+
+static void fs_cache_attributes(void *obj, void *data,
+                                QGuestAllocator *t_alloc)
+{
+    QVirtio9P *v9p = obj;
+    v9fs_set_allocator(t_alloc);
+    static const uint32_t write_count = P9_MAX_SIZE / 2;
+    g_autofree char *buf = g_malloc0(write_count);
+    struct v9fs_attr attr;
+    uint32_t fid_file, fid_attr;
+
+    tattach({ .client = v9p });
+    tmkdir({ .client = v9p, .atPath = "/", .name = "11" });
+    tlcreate({ .client = v9p, .atPath = "11", .name = "file" });
+
+    /* an unopened fid, so that Tgetattr goes through lstat() */
+    fid_attr = twalk({ .client = v9p, .path = "11/file" }).newfid;
+    tgetattr({
+        .client = v9p, .fid = fid_attr, .request_mask = P9_GETATTR_BASIC,
+        .rgetattr.attr = &attr
+    });
+    g_assert_cmpint(attr.size, ==, 0);
+
+    /* Twrite through another fid must update the cached size ... */
+    fid_file = twalk({ .client = v9p, .path = "11/file" }).newfid;
+    tlopen({ .client = v9p, .fid = fid_file, .flags = O_WRONLY });
+    twrite({
+        .client = v9p, .fid = fid_file, .offset = 0, .count = write_count,
+        .data = buf
+    });
+    tgetattr({
+        .client = v9p, .fid = fid_attr, .request_mask = P9_GETATTR_BASIC,
+        .rgetattr.attr = &attr
+    });
+    g_assert_cmpint(attr.size, ==, write_count);
+
+    /* ... and so must Tsetattr */
+    tsetattr({
+        .client = v9p, .fid = fid_attr, .attr = (v9fs_attr) {
+            .valid = P9_SETATTR_SIZE,
+            .size = 2001
+        }
+    });
+    tgetattr({
+        .client = v9p, .fid = fid_attr, .request_mask = P9_GETATTR_BASIC,
+        .rgetattr.attr = &attr
+    });
+    g_assert_cmpint(attr.size, ==, 2001);
+}
+
+static void fs_cache_rename_dir(void *obj, void *data,
+                                QGuestAllocator *t_alloc)
+{
+    QVirtio9P *v9p = obj;
+    v9fs_set_allocator(t_alloc);
+    struct stat st;
+    g_autofree char *renamed_file =
+        virtio_9p_test_path("12_renamed/sub/file");
+
+    tattach({ .client = v9p });
+    tmkdir({ .client = v9p, .atPath = "/", .name = "12" });
+    tmkdir({ .client = v9p, .atPath = "12", .name = "sub" });
+    tlcreate({ .client = v9p, .atPath = "12/sub", .name = "file" });
+
+    /* cache entries for the whole subtree */
+    twalk({ .client = v9p, .path = "12/sub/file" });
+
+    trenameat({
+        .client = v9p, .oldAtPath = "/", .oldname = "12",
+        .newAtPath = "/", .newname = "12_renamed"
+    });
+    g_assert(stat(renamed_file, &st) == 0);
+
+    /* nothing below the old name may still be found ... */
+    twalk({ .client = v9p, .path = "12/sub/file", .expectErr = ENOENT });
+    /* ... but everything below the new one */
+    twalk({ .client = v9p, .path = "12_renamed/sub/file" });
+
+    /* a new directory under the old name starts out empty */
+    tmkdir({ .client = v9p, .atPath = "/", .name = "12" });
+    twalk({ .client = v9p, .path = "12/sub", .expectErr = ENOENT });
+    tmkdir({ .client = v9p, .atPath = "12", .name = "sub" });
+    twalk({ .client = v9p, .path = "12/sub/file", .expectErr = ENOENT });
+}
+
 static void cleanup_9p_local_driver(void *data)
 {
     /* remove previously created test dir when test is completed */
@@ -769,6 +928,17 @@ static void *assign_9p_local_driver(GString *cmd_line, void *arg)
     return arg;
 }
 
+static void *assign_9p_local_driver_cache_loose(GString *cmd_line, void *arg)
+{
+    virtio_9p_create_local_test_dir();
+
+    virtio_9p_assign_local_driver(cmd_line,
+                                  "security_model=mapped-xattr,cache=loose");
+
+    g_test_queue_destroy(cleanup_9p_local_driver, NULL);
+    return arg;
+}
+
 static void register_virtio_9p_test(void)
 {
 
@@ -819,6 +989,17 @@ static void register_virtio_9p_test(void)
                  &opts);
     qos_add_test("local/use_after_unlink", "virtio-9p", fs_use_after_unlink,
                  &opts);
+    qos_add_test("local/readwrite_large", "virtio-9p", fs_readwrite_large,
+                 &opts);
+
+    /* 'local' filesystem driver with the metadata cache enabled */
+    opts.before = assign_9p_local_driver_cache_loose;
+    qos_add_test("local/cache/negative_entry", "virtio-9p",
+                 fs_cache_negative_entry, &opts);
+    qos_add_test("local/cache/attributes", "virtio-9p", fs_cache_attributes,
+                 &opts);
+    qos_add_test("local/cache/rename_dir", "virtio-9p", fs_cache_rename_dir,
+                 &opts);
 }
 
 libqos_init(register_virtio_9p_test);
@@ -0,0 +1,127 @@
+/*
+ * Test -native-libc: calls to memcpy, memset, memcmp and strlen are run
+ * natively, and a bad pointer raises SIGSEGV at the function's entry
+ * without modifying any memory.
+ *
+ * The binary is static, is not linked against libc and has plain (non-IFUNC)
+ * definitions of the functions, like a statically linked musl program.
+ * They record that they ran as guest code, so that the test can check that
+ * QEMU did intercept them.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stddef.h>
+#include "bti-crt.c.inc"
+
+static int guest_calls;
+
+void *memcpy(void *dst, const void *src, size_t len)
+{
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+
+    guest_calls++;
+    while (len--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
+
+void *memset(void *dst, int c, size_t len)
+{
+    unsigned char *d = dst;
+
+    guest_calls++;
+    while (len--) {
+        *d++ = c;
+    }
+    return dst;
+}
+
+int memcmp(const void *a, const void *b, size_t len)
+{
+    const unsigned char *x = a, *y = b;
+
+    guest_calls++;
+    for (; len; len--, x++, y++) {
+        if (*x != *y) {
+            return *x - *y;
+        }
+    }
+    return 0;
+}
+
+size_t strlen(const char *s)
+{
+    size_t len = 0;
+
+    guest_calls++;
+    while (s[len]) {
+        len++;
+    }
+    return len;
+}
+
+#define BAD_PTR ((void *)0x10)
+#define SEGV_RET 0x5e9f
+
+static int segv_count;
+static unsigned long segv_pc, segv_addr;
+
+static void segv_handler(int sig, siginfo_t *info, ucontext_t *uc)
+{
+    segv_count++;
+    segv_pc = uc->uc_mcontext.pc;
+    segv_addr = (unsigned long)info->si_addr;
+
+    /* Return from the faulting function to its caller */
+    uc->uc_mcontext.regs[0] = SEGV_RET;
+    uc->uc_mcontext.pc = uc->uc_mcontext.regs[30];
+}
+
+static char src[64] = "native calls";
+static char dst[64];
+
+int main(void)
+{
+    int fail = 0;
+    void *ret;
+
+    ret = memcpy(dst, src, sizeof(src));
+    fail |= ret != dst;
+    fail |= memcmp(dst, src, sizeof(src)) != 0;
+    fail |= strlen(dst) != 12;
+
+    ret = memset(dst, 'x', 4);
+    fail |= ret != dst;
+    fail |= memcmp(dst, "xxxxve calls", 13) != 0;
+    fail |= memcmp(dst, src, sizeof(src)) <= 0;
+    fail |= memcmp(dst, "xxxxz", 5) >= 0;
+
+    /* None of the above may have run the guest code */
+    fail |= (guest_calls != 0) << 1;
+
+    signal_info(SIGSEGV, segv_handler);
+
+    /* A bad source faults at the entry, before dst is written */
+    memset(dst, 0, sizeof(dst));
+    ret = memcpy(dst, BAD_PTR, sizeof(dst));
+    fail |= (ret != (void *)SEGV_RET) << 2;
+    fail |= (segv_count != 1) << 2;
+    fail |= (segv_pc != (unsigned long)memcpy) << 2;
+    fail |= (segv_addr != (unsigned long)BAD_PTR) << 2;
+    for (int i = 0; i < sizeof(dst); i++) {
+        fail |= (dst[i] != 0) << 3;
+    }
+
+    ret = memset(BAD_PTR, 0, 16);
+    fail |= (ret != (void *)SEGV_RET) << 4;
+    fail |= (segv_count != 2) << 4;
+    fail |= (segv_pc != (unsigned long)memset) << 4;
+    fail |= (segv_addr != (unsigned long)BAD_PTR) << 4;
+
+    fail |= (guest_calls != 0) << 5;
+
+    return fail;
+}
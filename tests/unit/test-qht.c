@@ -251,10 +251,17 @@ static void test_resize(void)
     qht_test(QHT_MODE_AUTO_RESIZE);
 }
 
+static void test_interleave(void)
+{
+    qht_test(QHT_MODE_INTERLEAVE);
+    qht_test(QHT_MODE_INTERLEAVE | QHT_MODE_AUTO_RESIZE);
+}
+
 int main(int argc, char *argv[])
 {
     g_test_init(&argc, &argv, NULL);
     g_test_add_func("/qht/mode/default", test_default);
     g_test_add_func("/qht/mode/resize", test_resize);
+    g_test_add_func("/qht/mode/interleave", test_interleave);
     return g_test_run();
 }
@@ -4,6 +4,7 @@
 #include "block/block.h"
 #include "qapi/error.h"
 #include "qemu/aiocb.h"
+#include "qemu/defer-call.h"
 #include "qemu/timer.h"
 #include "qemu/error-report.h"
 #include "qemu/main-loop.h"
@@ -231,6 +232,83 @@ static void test_cancel_async(void)
     do_test_cancel(false);
 }
 
+/*
+ * Requests submitted inside a defer_call_begin()/defer_call_end() section are
+ * kept on the pool's deferred list until the section ends, unless there are
+ * more than fit in one batch.  Cancel some of them while they are still
+ * there.
+ */
+static void test_submit_deferred(void)
+{
+    WorkerTestData data[50];
+    int i;
+
+    for (i = 0; i < 50; i++) {
+        data[i].n = 0;
+        data[i].ret = -EINPROGRESS;
+    }
+
+    defer_call_begin();
+    for (i = 0; i < 10; i++) {
+        data[i].aiocb = thread_pool_submit_aio(worker_cb, &data[i],
+                                               done_cb, &data[i]);
+    }
+    active = 10;
+
+    /* Nothing has been handed to the workers yet */
+    g_usleep(100000);
+    for (i = 0; i < 10; i++) {
+        g_assert_cmpint(qatomic_read(&data[i].n), ==, 0);
+    }
+
+    bdrv_aio_cancel_async(data[3].aiocb);
+    bdrv_aio_cancel(data[7].aiocb);
+    g_assert(data[7].aiocb == NULL);
+    g_assert_cmpint(data[7].ret, ==, -ECANCELED);
+    defer_call_end();
+
+    while (active > 0) {
+        aio_poll(ctx, true);
+    }
+    for (i = 0; i < 10; i++) {
+        g_assert(data[i].aiocb == NULL);
+        if (i == 3 || i == 7) {
+            g_assert_cmpint(data[i].n, ==, 0);
+            g_assert_cmpint(data[i].ret, ==, -ECANCELED);
+        } else {
+            g_assert_cmpint(data[i].n, ==, 1);
+            g_assert_cmpint(data[i].ret, ==, 0);
+        }
+    }
+
+    /*
+     * Submit more than one batch: the first batch goes to the workers while
+     * still in the section, and the last request stays deferred.
+     */
+    defer_call_begin();
+    for (i = 10; i < 50; i++) {
+        data[i].aiocb = thread_pool_submit_aio(worker_cb, &data[i],
+                                               done_cb, &data[i]);
+    }
+    active = 40;
+    bdrv_aio_cancel_async(data[49].aiocb);
+    defer_call_end();
+
+    while (active > 0) {
+        aio_poll(ctx, true);
+    }
+    for (i = 10; i < 50; i++) {
+        g_assert(data[i].aiocb == NULL);
+        if (i == 49) {
+            g_assert_cmpint(data[i].n, ==, 0);
+            g_assert_cmpint(data[i].ret, ==, -ECANCELED);
+        } else {
+            g_assert_cmpint(data[i].n, ==, 1);
+            g_assert_cmpint(data[i].ret, ==, 0);
+        }
+    }
+}
+
 int main(int argc, char **argv)
 {
     qemu_init_main_loop(&error_abort);
@@ -241,6 +319,7 @@ int main(int argc, char **argv)
     g_test_add_func("/thread-pool/submit-aio", test_submit_aio);
     g_test_add_func("/thread-pool/submit-co", test_submit_co);
     g_test_add_func("/thread-pool/submit-many", test_submit_many);
+    g_test_add_func("/thread-pool/submit-deferred", test_submit_deferred);
     g_test_add_func("/thread-pool/cancel", test_cancel);
     g_test_add_func("/thread-pool/cancel-async", test_cancel_async);
 
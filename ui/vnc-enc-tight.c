@@ -1447,6 +1447,17 @@ static int send_sub_rect_nojpeg(VncState *vs, VncWorker *worker,
 }
 
 #ifdef CONFIG_VNC_JPEG
+/*
+ * JPEG quality for the client's requested quality level, lowered while the
+ * client is congested (see vnc_update_lossy_backoff()).
+ */
+static int tight_jpeg_quality(VncState *vs, VncTight *tight)
+{
+    int level = MAX((int)tight->quality - vs->lossy_backoff, 0);
+
+    return tight_conf[level].jpeg_quality;
+}
+
 static int send_sub_rect_jpeg(VncState *vs, VncWorker *worker,
                               int x, int y, int w, int h,
                               int bg, int fg, int colors,
@@ -1457,7 +1468,7 @@ static int send_sub_rect_jpeg(VncState *vs, VncWorker *worker,
     if (colors == 0) {
         if (force || (tight_jpeg_conf[worker->tight.quality].jpeg_full &&
                       tight_detect_smooth_image(vs, &worker->tight, w, h))) {
-            int quality = tight_conf[worker->tight.quality].jpeg_quality;
+            int quality = tight_jpeg_quality(vs, &worker->tight);
 
             ret = send_jpeg_rect(vs, worker, x, y, w, h, quality);
         } else {
@@ -1471,7 +1482,7 @@ static int send_sub_rect_jpeg(VncState *vs, VncWorker *worker,
         if (force || (colors > 96 &&
                       tight_jpeg_conf[worker->tight.quality].jpeg_idx &&
                       tight_detect_smooth_image(vs, &worker->tight, w, h))) {
-            int quality = tight_conf[worker->tight.quality].jpeg_quality;
+            int quality = tight_jpeg_quality(vs, &worker->tight);
 
             ret = send_jpeg_rect(vs, worker, x, y, w, h, quality);
         } else {
@@ -30,6 +30,8 @@
 #ifndef VNC_JOBS_H
 #define VNC_JOBS_H
 
+#define VNC_MAX_ENCODER_THREADS 64
+
 /* Jobs */
 VncJob *vnc_job_new(VncState *vs);
 int vnc_job_add_rect(VncJob *job, int x, int y, int w, int h);
@@ -37,21 +39,45 @@ void vnc_job_push(VncJob *job);
 void vnc_jobs_join(VncState *vs);
 
 void vnc_jobs_consume_buffer(VncState *vs);
-void vnc_start_worker_thread(void);
+void vnc_start_worker_threads(int nr_threads);
 
 /* Locks */
+
+/*
+ * Encoding threads only read the server surface, so any number of them
+ * may do so at the same time, between vnc_display_start_read() and
+ * vnc_display_end_read().  vnc_trylock_display() fails while there are
+ * readers, so that vnc_refresh() does not update the surface under them.
+ */
 static inline int vnc_trylock_display(VncDisplay *vd)
 {
-    return qemu_mutex_trylock(&vd->mutex);
+    if (qemu_mutex_trylock(&vd->mutex)) {
+        return -EBUSY;
+    }
+    if (vd->readers) {
+        qemu_mutex_unlock(&vd->mutex);
+        return -EBUSY;
+    }
+    return 0;
+}
+
+static inline void vnc_unlock_display(VncDisplay *vd)
+{
+    qemu_mutex_unlock(&vd->mutex);
 }
 
-static inline void vnc_lock_display(VncDisplay *vd)
+static inline void vnc_display_start_read(VncDisplay *vd)
 {
     qemu_mutex_lock(&vd->mutex);
+    vd->readers++;
+    qemu_mutex_unlock(&vd->mutex);
 }
 
-static inline void vnc_unlock_display(VncDisplay *vd)
+static inline void vnc_display_end_read(VncDisplay *vd)
 {
+    qemu_mutex_lock(&vd->mutex);
+    assert(vd->readers > 0);
+    vd->readers--;
     qemu_mutex_unlock(&vd->mutex);
 }
 
@@ -1144,6 +1144,33 @@ static bool vnc_should_update(VncState *vs)
     return false;
 }
 
+/*
+ * Trade JPEG quality for bandwidth: degrade lossy updates by one quality
+ * level each time an update has to be held back because the client has
+ * not drained the previous ones yet, and restore one level each time an
+ * update is sent while the output buffer is already empty.
+ */
+static void vnc_update_lossy_backoff(VncState *vs, bool congested)
+{
+    int backoff = vs->lossy_backoff;
+
+    if (vs->vd->non_adaptive) {
+        return;
+    }
+
+    if (congested) {
+        backoff = MIN(backoff + 1, VNC_LOSSY_BACKOFF_MAX);
+    } else if (vs->output.offset == 0) {
+        backoff = MAX(backoff - 1, 0);
+    }
+
+    if (backoff != vs->lossy_backoff) {
+        trace_vnc_client_lossy_backoff(vs, vs->ioc, backoff,
+                                       vs->output.offset);
+        vs->lossy_backoff = backoff;
+    }
+}
+
 static int vnc_update_client(VncState *vs, int has_dirty)
 {
     VncDisplay *vd = vs->vd;
@@ -1159,6 +1186,10 @@ static int vnc_update_client(VncState *vs, int has_dirty)
 
     vs->has_dirty += has_dirty;
     if (!vnc_should_update(vs)) {
+        if (vs->has_dirty && vs->update == VNC_STATE_UPDATE_INCREMENTAL &&
+            vs->output.offset >= vs->throttle_output_offset) {
+            vnc_update_lossy_backoff(vs, true);
+        }
         return 0;
     }
 
@@ -1166,6 +1197,8 @@ static int vnc_update_client(VncState *vs, int has_dirty)
         return 0;
     }
 
+    vnc_update_lossy_backoff(vs, false);
+
     /*
      * Send screen updates to the vnc client using the server
      * surface and server dirty map.  guest surface updates
@@ -3161,8 +3194,8 @@ static int vnc_refresh_server_surface(VncDisplay *vd)
     int has_dirty = 0;
     pixman_image_t *tmpbuf = NULL;
     unsigned long offset;
-    int x;
-    uint8_t *guest_ptr, *server_ptr;
+    int x, x_end, run_end, run_bytes;
+    uint8_t *guest_line, *server_line, *guest_ptr, *server_ptr;
 
     struct timeval tv = { 0, 0 };
 
@@ -3200,43 +3233,66 @@ static int vnc_refresh_server_surface(VncDisplay *vd)
                    * DIV_ROUND_UP(guest_bpp, 8);
     }
     line_bytes = MIN(server_stride, guest_ll);
+    x_end = DIV_ROUND_UP(width, VNC_DIRTY_PIXELS_PER_BIT);
 
     for (;;) {
         y = offset / VNC_DIRTY_BPL(&vd->guest);
         x = offset % VNC_DIRTY_BPL(&vd->guest);
 
-        server_ptr = server_row0 + y * server_stride + x * cmp_bytes;
+        server_line = server_row0 + y * server_stride;
 
         if (vd->guest.format != VNC_SERVER_FB_FORMAT) {
             qemu_pixman_linebuf_fill(tmpbuf, vd->guest.fb, width, 0, y);
-            guest_ptr = (uint8_t *)pixman_image_get_data(tmpbuf);
+            guest_line = (uint8_t *)pixman_image_get_data(tmpbuf);
         } else {
-            guest_ptr = guest_row0 + y * guest_stride;
+            guest_line = guest_row0 + y * guest_stride;
         }
-        guest_ptr += x * cmp_bytes;
 
-        for (; x < DIV_ROUND_UP(width, VNC_DIRTY_PIXELS_PER_BIT);
-             x++, guest_ptr += cmp_bytes, server_ptr += cmp_bytes) {
-            int _cmp_bytes = cmp_bytes;
-            if (!test_and_clear_bit(x, vd->guest.dirty[y])) {
-                continue;
-            }
-            if ((x + 1) * cmp_bytes > line_bytes) {
-                _cmp_bytes = line_bytes - x * cmp_bytes;
+        /*
+         * Handle the dirty bits of this line in runs.  Display devices
+         * usually report damage at page or scanline granularity, most of
+         * which turns out to be unchanged, so check the whole run with a
+         * single memcmp() before looking at each VNC_DIRTY_PIXELS_PER_BIT
+         * chunk.
+         */
+        while (x < x_end) {
+            x = find_next_bit(vd->guest.dirty[y], x_end, x);
+            if (x >= x_end) {
+                break;
             }
-            assert(_cmp_bytes >= 0);
-            if (memcmp(server_ptr, guest_ptr, _cmp_bytes) == 0) {
+            run_end = find_next_zero_bit(vd->guest.dirty[y], x_end, x);
+            bitmap_clear(vd->guest.dirty[y], x, run_end - x);
+
+            run_bytes = MIN(run_end * cmp_bytes, line_bytes) - x * cmp_bytes;
+            if (run_bytes <= 0 ||
+                memcmp(server_line + x * cmp_bytes, guest_line + x * cmp_bytes,
+                       run_bytes) == 0) {
+                x = run_end;
                 continue;
             }
-            memcpy(server_ptr, guest_ptr, _cmp_bytes);
-            if (!vd->non_adaptive) {
-                vnc_rect_updated(vd, x * VNC_DIRTY_PIXELS_PER_BIT,
-                                 y, &tv);
-            }
-            QTAILQ_FOREACH(vs, &vd->clients, next) {
-                set_bit(x, vs->dirty[y]);
+
+            server_ptr = server_line + x * cmp_bytes;
+            guest_ptr = guest_line + x * cmp_bytes;
+            for (; x < run_end;
+                 x++, guest_ptr += cmp_bytes, server_ptr += cmp_bytes) {
+                int _cmp_bytes = cmp_bytes;
+                if ((x + 1) * cmp_bytes > line_bytes) {
+                    _cmp_bytes = line_bytes - x * cmp_bytes;
+                }
+                assert(_cmp_bytes >= 0);
+                if (memcmp(server_ptr, guest_ptr, _cmp_bytes) == 0) {
+                    continue;
+                }
+                memcpy(server_ptr, guest_ptr, _cmp_bytes);
+                if (!vd->non_adaptive) {
+                    vnc_rect_updated(vd, x * VNC_DIRTY_PIXELS_PER_BIT,
+                                     y, &tv);
+                }
+                QTAILQ_FOREACH(vs, &vd->clients, next) {
+                    set_bit(x, vs->dirty[y]);
+                }
+                has_dirty++;
             }
-            has_dirty++;
         }
 
         y++;
@@ -3472,7 +3528,7 @@ void vnc_display_init(const char *id, Error **errp)
     vd->connections_limit = 32;
 
     qemu_mutex_init(&vd->mutex);
-    vnc_start_worker_thread();
+    vnc_start_worker_threads(1);
 
     vd->dcl.ops = &dcl_ops;
     register_displaychangelistener(&vd->dcl);
@@ -3651,6 +3707,9 @@ static QemuOptsList qemu_vnc_opts = {
         },{
             .name = "power-control",
             .type = QEMU_OPT_BOOL,
+        },{
+            .name = "encoder-threads",
+            .type = QEMU_OPT_NUMBER,
         },
         { /* end of list */ }
     },
@@ -4080,6 +4139,7 @@ void vnc_display_open(const char *id, Error **errp)
     const char *saslauthz;
     int lock_key_sync = 1;
     int key_delay_ms;
+    uint64_t encoder_threads;
     const char *audiodev;
     const char *passwordSecret;
 
@@ -4189,6 +4249,14 @@ void vnc_display_open(const char *id, Error **errp)
     }
     vd->connections_limit = qemu_opt_get_number(opts, "connections", 32);
 
+    encoder_threads = qemu_opt_get_number(opts, "encoder-threads", 1);
+    if (encoder_threads < 1 || encoder_threads > VNC_MAX_ENCODER_THREADS) {
+        error_setg(errp, "vnc encoder-threads must be between 1 and %d",
+                   VNC_MAX_ENCODER_THREADS);
+        goto fail;
+    }
+    vnc_start_worker_threads(encoder_threads);
+
 #ifdef CONFIG_VNC_JPEG
     vd->lossy = qemu_opt_get_bool(opts, "lossy", false);
 #endif
@@ -97,6 +97,9 @@ typedef void VncSendHextileTile(VncState *vs,
 
 #define VNC_AUTH_CHALLENGE_SIZE 16
 
+/* Maximum number of JPEG quality levels dropped for congested clients */
+#define VNC_LOSSY_BACKOFF_MAX 9
+
 typedef struct VncDisplay VncDisplay;
 
 #include "vnc-auth-vencrypt.h"
@@ -158,6 +161,7 @@ struct VncDisplay
     int ledstate;
     QKbdState *kbd;
     QemuMutex mutex;
+    int readers; /* encoding threads reading @server, protected by @mutex */
 
     int cursor_msize;
     uint8_t *cursor_mask;
@@ -250,6 +254,7 @@ struct VncRectEntry
 struct VncJob
 {
     VncState *vs;
+    bool running;
 
     QLIST_HEAD(, VncRectEntry) rectangles;
     QTAILQ_ENTRY(VncJob) next;
@@ -317,6 +322,11 @@ struct VncState
      * is calculating dynamically based on framebuffer size
      * and audio sample settings in vnc_update_throttle_offset() */
     size_t throttle_output_offset;
+    /* Number of JPEG quality levels by which lossy tight updates are
+     * currently degraded below what the client asked for, because the
+     * client does not keep up with the updates we send. Adjusted in
+     * vnc_update_client(). */
+    int lossy_backoff;
     Buffer output;
     Buffer input;
     /* current output mode information */
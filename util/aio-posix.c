@@ -530,6 +530,13 @@ static bool run_poll_handlers(AioContext *ctx, AioHandlerList *ready_list,
         }
     } while (elapsed_time < max_ns);
 
+    if (progress) {
+        qatomic_set(&ctx->poll_hits, ctx->poll_hits + 1);
+    } else {
+        qatomic_set(&ctx->poll_misses, ctx->poll_misses + 1);
+    }
+    qatomic_set(&ctx->poll_time_ns, ctx->poll_time_ns + elapsed_time);
+
     if (remove_idle_poll_handlers(ctx, ready_list,
                                   start_time + elapsed_time)) {
         *timeout = 0;
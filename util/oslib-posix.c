@@ -60,6 +60,7 @@
 
 #include "qemu/memalign.h"
 #include "qemu/mmap-alloc.h"
+#include "qemu/timer.h"
 
 #define MAX_MEM_PREALLOC_THREAD_COUNT 16
 
@@ -681,6 +682,122 @@ bool qemu_prealloc_mem(int fd, char *area, size_t sz, int max_threads,
     return rv;
 }
 
+/* Granularity in which background preallocation populates memory */
+#define MEM_PREALLOC_BACKGROUND_CHUNK (256 * MiB)
+
+struct MemPreallocBackground {
+    char *area;
+    size_t size;
+    size_t chunk_size;
+    size_t next;            /* offset of the next chunk to populate, atomic */
+    bool cancel;            /* stop after an error, atomic */
+    int ret;                /* first error, atomic */
+    int running;            /* number of running threads, atomic */
+    int num_threads;
+    QemuThread *threads;
+    int64_t start_ns;
+    void (*cb)(void *opaque, int ret);
+    void *opaque;
+};
+
+static void *do_prealloc_background(void *arg)
+{
+    MemPreallocBackground *bg = arg;
+    size_t offset;
+
+    while (!qatomic_read(&bg->cancel)) {
+        offset = qatomic_fetch_add(&bg->next, bg->chunk_size);
+        if (offset >= bg->size) {
+            break;
+        }
+        if (qemu_madvise(bg->area + offset,
+                         MIN(bg->chunk_size, bg->size - offset),
+                         QEMU_MADV_POPULATE_WRITE)) {
+            qatomic_cmpxchg(&bg->ret, 0, -errno);
+            qatomic_set(&bg->cancel, true);
+            break;
+        }
+    }
+
+    if (qatomic_fetch_dec(&bg->running) == 1) {
+        trace_qemu_prealloc_mem_background_done(bg->area, bg->size,
+                                                qatomic_read(&bg->ret),
+                                                (get_clock() - bg->start_ns) /
+                                                SCALE_MS);
+        if (bg->cb) {
+            bg->cb(bg->opaque, qatomic_read(&bg->ret));
+        }
+    }
+    return NULL;
+}
+
+MemPreallocBackground *
+qemu_prealloc_mem_background(int fd, char *area, size_t sz, int max_threads,
+                             ThreadContext *tc,
+                             void (*cb)(void *opaque, int ret), void *opaque,
+                             Error **errp)
+{
+#ifndef EMSCRIPTEN
+    size_t hpagesize = qemu_fd_getpagesize(fd);
+#else
+    size_t hpagesize = qemu_real_host_page_size();
+#endif
+    size_t numpages = DIV_ROUND_UP(sz, hpagesize);
+    MemPreallocBackground *bg;
+    int i;
+
+    /*
+     * Touching pages would require a SIGBUS handler while vCPUs are already
+     * running, so only MADV_POPULATE_WRITE is supported here.
+     */
+    if (!madv_populate_write_possible(area, hpagesize)) {
+        error_setg(errp, "background preallocation requires "
+                   "MADV_POPULATE_WRITE support");
+        return NULL;
+    }
+
+    bg = g_new0(MemPreallocBackground, 1);
+    bg->area = area;
+    bg->size = numpages * hpagesize;
+    bg->chunk_size = ROUND_UP(MEM_PREALLOC_BACKGROUND_CHUNK, hpagesize);
+    bg->num_threads = get_memset_num_threads(hpagesize, numpages, max_threads);
+    bg->running = bg->num_threads;
+    bg->threads = g_new0(QemuThread, bg->num_threads);
+    bg->start_ns = get_clock();
+    bg->cb = cb;
+    bg->opaque = opaque;
+
+    trace_qemu_prealloc_mem_background(area, bg->size, bg->num_threads);
+
+    /*
+     * All threads take chunks from the same cursor, so memory gets populated
+     * roughly in ascending address order.
+     */
+    for (i = 0; i < bg->num_threads; i++) {
+        if (tc) {
+            thread_context_create_thread(tc, &bg->threads[i], "prealloc_bg",
+                                         do_prealloc_background, bg,
+                                         QEMU_THREAD_JOINABLE);
+        } else {
+            qemu_thread_create(&bg->threads[i], "prealloc_bg",
+                               do_prealloc_background, bg,
+                               QEMU_THREAD_JOINABLE);
+        }
+    }
+    return bg;
+}
+
+void qemu_prealloc_mem_background_free(MemPreallocBackground *bg)
+{
+    int i;
+
+    for (i = 0; i < bg->num_threads; i++) {
+        qemu_thread_join(&bg->threads[i]);
+    }
+    g_free(bg->threads);
+    g_free(bg);
+}
+
 char *qemu_get_pid_name(pid_t pid)
 {
     char *name = NULL;
@@ -23,6 +23,7 @@
 
 enum {
     COROUTINE_POOL_BATCH_MAX_SIZE = 128,
+    COROUTINE_POOL_LOCAL_DEFAULT_BATCHES = 2,
 };
 
 /*
@@ -34,7 +35,8 @@ enum {
  * The pool is global but each thread maintains a small local pool to avoid
  * global pool contention. Threads fetch and return batches of coroutines from
  * the global pool to maintain their local pool. The local pool holds up to two
- * batches whereas the maximum size of the global pool is controlled by the
+ * batches by default (see qemu_coroutine_set_local_pool_size()) whereas the
+ * maximum size of the global pool is controlled by the
  * qemu_coroutine_inc_pool_size() API.
  *
  * .-----------------------------------.
@@ -65,8 +67,56 @@ static unsigned int global_pool_size;
 static unsigned int global_pool_max_size = COROUTINE_POOL_BATCH_MAX_SIZE;
 
 QEMU_DEFINE_STATIC_CO_TLS(CoroutinePool, local_pool);
+QEMU_DEFINE_STATIC_CO_TLS(unsigned int, local_pool_batches);
+QEMU_DEFINE_STATIC_CO_TLS(unsigned int, local_pool_max_batches);
 QEMU_DEFINE_STATIC_CO_TLS(Notifier, local_pool_cleanup_notifier);
 
+/*
+ * Pool hit/miss counters are kept per thread so that the fast path doesn't
+ * bounce a shared cache line between threads. They are only written by their
+ * own thread and summed up by qemu_coroutine_get_pool_stats().
+ */
+typedef struct CoroutineThreadStats {
+    uint64_t pool_hits;
+    uint64_t pool_misses;
+    QLIST_ENTRY(CoroutineThreadStats) next;
+} CoroutineThreadStats;
+
+QEMU_DEFINE_STATIC_CO_TLS(CoroutineThreadStats, local_stats);
+QEMU_DEFINE_STATIC_CO_TLS(bool, local_stats_registered);
+
+/* Protected by global_pool_lock */
+static QLIST_HEAD(, CoroutineThreadStats) thread_stats =
+    QLIST_HEAD_INITIALIZER(thread_stats);
+static uint64_t exited_pool_hits;
+static uint64_t exited_pool_misses;
+
+/* Number of coroutines (and thus stacks) in existence, pooled or not */
+static uint64_t nr_allocated;
+static uint64_t nr_allocated_peak;
+
+static Coroutine *coroutine_alloc(void)
+{
+    uint64_t n = qatomic_fetch_inc(&nr_allocated) + 1;
+    uint64_t peak = qatomic_read(&nr_allocated_peak);
+
+    while (n > peak) {
+        uint64_t old = qatomic_cmpxchg(&nr_allocated_peak, peak, n);
+        if (old == peak) {
+            break;
+        }
+        peak = old;
+    }
+
+    return qemu_coroutine_new();
+}
+
+static void coroutine_free(Coroutine *co)
+{
+    qemu_coroutine_delete(co);
+    qatomic_dec(&nr_allocated);
+}
+
 static CoroutinePoolBatch *coroutine_pool_batch_new(void)
 {
     CoroutinePoolBatch *batch = g_new(CoroutinePoolBatch, 1);
@@ -83,7 +133,7 @@ static void coroutine_pool_batch_delete(CoroutinePoolBatch *batch)
 
     QSLIST_FOREACH_SAFE(co, &batch->list, pool_next, tmp) {
         QSLIST_REMOVE_HEAD(&batch->list, pool_next);
-        qemu_coroutine_delete(co);
+        coroutine_free(co);
     }
     g_free(batch);
 }
@@ -98,6 +148,17 @@ static void local_pool_cleanup(Notifier *n, void *value)
         QSLIST_REMOVE_HEAD(local_pool, next);
         coroutine_pool_batch_delete(batch);
     }
+    set_local_pool_batches(0);
+
+    if (get_local_stats_registered()) {
+        CoroutineThreadStats *stats = get_ptr_local_stats();
+
+        QEMU_LOCK_GUARD(&global_pool_lock);
+        exited_pool_hits += stats->pool_hits;
+        exited_pool_misses += stats->pool_misses;
+        QLIST_REMOVE(stats, next);
+        set_local_stats_registered(false);
+    }
 }
 
 /* Ensure the atexit notifier is registered */
@@ -110,6 +171,20 @@ static void local_pool_cleanup_init_once(void)
     }
 }
 
+static CoroutineThreadStats *local_stats_get(void)
+{
+    CoroutineThreadStats *stats = get_ptr_local_stats();
+
+    if (unlikely(!get_local_stats_registered())) {
+        WITH_QEMU_LOCK_GUARD(&global_pool_lock) {
+            QLIST_INSERT_HEAD(&thread_stats, stats, next);
+        }
+        set_local_stats_registered(true);
+        local_pool_cleanup_init_once();
+    }
+    return stats;
+}
+
 /* Helper to get the next unused coroutine from the local pool */
 static Coroutine *coroutine_pool_get_local(void)
 {
@@ -128,6 +203,7 @@ static Coroutine *coroutine_pool_get_local(void)
     if (batch->size == 0) {
         QSLIST_REMOVE_HEAD(local_pool, next);
         coroutine_pool_batch_delete(batch);
+        set_local_pool_batches(get_local_pool_batches() - 1);
     }
     return co;
 }
@@ -149,6 +225,7 @@ static void coroutine_pool_refill_local(void)
 
     if (batch) {
         QSLIST_INSERT_HEAD(local_pool, batch, next);
+        set_local_pool_batches(get_local_pool_batches() + 1);
         local_pool_cleanup_init_once();
     }
 }
@@ -194,20 +271,24 @@ static void coroutine_pool_put(Coroutine *co)
     if (unlikely(!batch)) {
         batch = coroutine_pool_batch_new();
         QSLIST_INSERT_HEAD(local_pool, batch, next);
+        set_local_pool_batches(1);
         local_pool_cleanup_init_once();
     }
 
     if (unlikely(batch->size >= COROUTINE_POOL_BATCH_MAX_SIZE)) {
-        CoroutinePoolBatch *next = QSLIST_NEXT(batch, next);
+        unsigned int max_batches = get_local_pool_max_batches() ?:
+                                   COROUTINE_POOL_LOCAL_DEFAULT_BATCHES;
 
         /* Is the local pool full? */
-        if (next) {
+        if (get_local_pool_batches() >= max_batches) {
             QSLIST_REMOVE_HEAD(local_pool, next);
+            set_local_pool_batches(get_local_pool_batches() - 1);
             coroutine_pool_put_global(batch);
         }
 
         batch = coroutine_pool_batch_new();
         QSLIST_INSERT_HEAD(local_pool, batch, next);
+        set_local_pool_batches(get_local_pool_batches() + 1);
     }
 
     QSLIST_INSERT_HEAD(&batch->list, co, pool_next);
@@ -216,14 +297,18 @@ static void coroutine_pool_put(Coroutine *co)
 
 Coroutine *qemu_coroutine_create(CoroutineEntry *entry, void *opaque)
 {
+    CoroutineThreadStats *stats = local_stats_get();
     Coroutine *co = NULL;
 
     if (IS_ENABLED(CONFIG_COROUTINE_POOL)) {
         co = coroutine_pool_get();
     }
 
-    if (!co) {
-        co = qemu_coroutine_new();
+    if (co) {
+        qatomic_set(&stats->pool_hits, stats->pool_hits + 1);
+    } else {
+        qatomic_set(&stats->pool_misses, stats->pool_misses + 1);
+        co = coroutine_alloc();
     }
 
     co->entry = entry;
@@ -239,7 +324,7 @@ static void coroutine_delete(Coroutine *co)
     if (IS_ENABLED(CONFIG_COROUTINE_POOL)) {
         coroutine_pool_put(co);
     } else {
-        qemu_coroutine_delete(co);
+        coroutine_free(co);
     }
 }
 
@@ -361,6 +446,35 @@ void qemu_coroutine_dec_pool_size(unsigned int removing_pool_size)
     global_pool_max_size -= removing_pool_size;
 }
 
+void qemu_coroutine_set_local_pool_size(unsigned int size)
+{
+    unsigned int batches = DIV_ROUND_UP(size, COROUTINE_POOL_BATCH_MAX_SIZE);
+
+    /*
+     * Never go below the default. Excess batches are handed to the global pool
+     * as the pool is used.
+     */
+    set_local_pool_max_batches(MAX(batches,
+                                   COROUTINE_POOL_LOCAL_DEFAULT_BATCHES));
+}
+
+void qemu_coroutine_get_pool_stats(CoroutinePoolStats *stats)
+{
+    CoroutineThreadStats *ts;
+
+    QEMU_LOCK_GUARD(&global_pool_lock);
+
+    stats->pool_hits = exited_pool_hits;
+    stats->pool_misses = exited_pool_misses;
+    QLIST_FOREACH(ts, &thread_stats, next) {
+        stats->pool_hits += qatomic_read(&ts->pool_hits);
+        stats->pool_misses += qatomic_read(&ts->pool_misses);
+    }
+    stats->global_pool_size = global_pool_size;
+    stats->allocated = qatomic_read(&nr_allocated);
+    stats->allocated_peak = qatomic_read(&nr_allocated_peak);
+}
+
 static unsigned int get_global_pool_hard_max_size(void)
 {
 #ifdef __linux__
@@ -52,6 +52,10 @@
  * acquiring their bucket lock. If they don't match, a resize has occurred
  * while the bucket spinlock was being acquired.
  *
+ * With QHT_MODE_INTERLEAVE, the pages of the head bucket array are spread
+ * round-robin over the host NUMA nodes, so that lookups from vCPU threads
+ * running on different sockets do not all hit the memory of a single node.
+ *
  * Related Work:
  * - Idea of cacheline-sized buckets with full hashes taken from:
  *   David, Guerraoui & Trigonakis, "Asynchronized Concurrency:
@@ -71,6 +75,10 @@
 #include "qemu/rcu.h"
 #include "qemu/memalign.h"
 
+#ifdef CONFIG_NUMA
+#include <numa.h>
+#endif
+
 //#define QHT_DEBUG
 
 /*
@@ -183,6 +191,7 @@ struct qht_tsan_lock {
 struct qht_map {
     struct rcu_head rcu;
     struct qht_bucket *buckets;
+    size_t buckets_mmap_size; /* 0 if @buckets is from qemu_memalign() */
     size_t n_buckets;
     size_t n_added_buckets;
     size_t n_added_buckets_threshold;
@@ -432,11 +441,51 @@ static void qht_map_destroy(struct qht_map *map)
     for (i = 0; i < map->n_buckets; i++) {
         qht_chain_destroy(map, &map->buckets[i]);
     }
+#ifdef CONFIG_POSIX
+    if (map->buckets_mmap_size) {
+        munmap(map->buckets, map->buckets_mmap_size);
+        g_free(map);
+        return;
+    }
+#endif
     qemu_vfree(map->buckets);
     g_free(map);
 }
 
-static struct qht_map *qht_map_create(size_t n_buckets)
+/*
+ * Allocate the head buckets of a map.  With QHT_MODE_INTERLEAVE, arrays
+ * of at least two pages get a mapping of their own: the memory policy is
+ * then confined to the array, cannot outlive it, and is in place before
+ * qht_head_init() faults in the first page.
+ */
+static void qht_buckets_alloc(const struct qht *ht, struct qht_map *map)
+{
+    size_t size = sizeof(struct qht_bucket) * map->n_buckets;
+#ifdef CONFIG_POSIX
+    size_t pagesize = qemu_real_host_page_size();
+
+    if ((ht->mode & QHT_MODE_INTERLEAVE) && size >= 2 * pagesize) {
+        size_t mmap_size = ROUND_UP(size, pagesize);
+        void *buckets = mmap(NULL, mmap_size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (buckets != MAP_FAILED) {
+#ifdef CONFIG_NUMA
+            if (numa_available() >= 0 && numa_num_configured_nodes() > 1) {
+                numa_interleave_memory(buckets, mmap_size, numa_all_nodes_ptr);
+            }
+#endif
+            map->buckets = buckets;
+            map->buckets_mmap_size = mmap_size;
+            return;
+        }
+    }
+#endif
+    map->buckets = qemu_memalign(QHT_BUCKET_ALIGN, size);
+    map->buckets_mmap_size = 0;
+}
+
+static struct qht_map *qht_map_create(const struct qht *ht, size_t n_buckets)
 {
     struct qht_map *map;
     size_t i;
@@ -453,8 +502,7 @@ static struct qht_map *qht_map_create(size_t n_buckets)
         map->n_added_buckets_threshold = 1;
     }
 
-    map->buckets = qemu_memalign(QHT_BUCKET_ALIGN,
-                                 sizeof(*map->buckets) * n_buckets);
+    qht_buckets_alloc(ht, map);
     for (i = 0; i < n_buckets; i++) {
         qht_head_init(map, &map->buckets[i]);
     }
@@ -471,7 +519,7 @@ void qht_init(struct qht *ht, qht_cmp_func_t cmp, size_t n_elems,
     ht->cmp = cmp;
     ht->mode = mode;
     qemu_mutex_init(&ht->lock);
-    map = qht_map_create(n_buckets);
+    map = qht_map_create(ht, n_buckets);
     qatomic_rcu_set(&ht->map, map);
 }
 
@@ -543,7 +591,7 @@ bool qht_reset_size(struct qht *ht, size_t n_elems)
     qht_lock(ht);
     map = ht->map;
     if (n_buckets != map->n_buckets) {
-        new = qht_map_create(n_buckets);
+        new = qht_map_create(ht, n_buckets);
     }
     qht_do_resize_and_reset(ht, new);
     qht_unlock(ht);
@@ -684,7 +732,7 @@ static __attribute__((noinline)) void qht_grow_maybe(struct qht *ht)
     map = ht->map;
     /* another thread might have just performed the resize we were after */
     if (qht_map_needs_resize(map)) {
-        struct qht_map *new = qht_map_create(map->n_buckets * 2);
+        struct qht_map *new = qht_map_create(ht, map->n_buckets * 2);
 
         qht_do_resize(ht, new);
     }
@@ -958,7 +1006,7 @@ bool qht_resize(struct qht *ht, size_t n_elems)
     if (n_buckets != ht->map->n_buckets) {
         struct qht_map *new;
 
-        new = qht_map_create(n_buckets);
+        new = qht_map_create(ht, n_buckets);
         qht_do_resize(ht, new);
         ret = true;
     }
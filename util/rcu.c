@@ -32,6 +32,7 @@
 #include "qemu/thread.h"
 #include "qemu/main-loop.h"
 #include "qemu/lockable.h"
+#include "qemu/timer.h"
 #if defined(CONFIG_MALLOC_TRIM)
 #include <malloc.h>
 #endif
@@ -51,9 +52,16 @@ unsigned long rcu_gp_ctr = RCU_GP_LOCKED;
 QemuEvent rcu_gp_event;
 static int in_drain_call_rcu;
 static int rcu_call_count;
+static int rcu_call_count_peak;
 static QemuMutex rcu_registry_lock;
 static QemuMutex rcu_sync_lock;
 
+/*
+ * Grace period statistics are written under rcu_sync_lock, callbacks only
+ * by the call_rcu thread; rcu_get_stats() reads them without a lock.
+ */
+static RCUStats rcu_stats;
+
 /*
  * Check whether a quiescent state was crossed between the beginning of
  * update_counter_and_wait and now.
@@ -98,6 +106,8 @@ static void wait_for_readers(void)
             (qatomic_read(&rcu_call_count) >= RCU_CALL_MIN_SIZE ||
              sleeps >= 5 || qatomic_read(&in_drain_call_rcu))) {
             forced = true;
+            qatomic_set(&rcu_stats.forced_grace_periods,
+                        rcu_stats.forced_grace_periods + 1);
 
             QLIST_FOREACH(index, &registry, node) {
                 notifier_list_notify(&index->force_rcu, NULL);
@@ -173,6 +183,8 @@ static void wait_for_readers(void)
 
 void synchronize_rcu(void)
 {
+    int64_t start, elapsed;
+
     QEMU_LOCK_GUARD(&rcu_sync_lock);
 
     /* Write RCU-protected pointers before reading p_rcu_reader->ctr.
@@ -185,6 +197,7 @@ void synchronize_rcu(void)
 
     QEMU_LOCK_GUARD(&rcu_registry_lock);
     if (!QLIST_EMPTY(&registry)) {
+        start = get_clock();
         if (sizeof(rcu_gp_ctr) < 8) {
             /* For architectures with 32-bit longs, a two-subphases algorithm
              * ensures we do not encounter overflow bugs.
@@ -200,6 +213,14 @@ void synchronize_rcu(void)
         }
 
         wait_for_readers();
+
+        elapsed = get_clock() - start;
+        qatomic_set(&rcu_stats.grace_periods, rcu_stats.grace_periods + 1);
+        qatomic_set(&rcu_stats.grace_period_ns,
+                    rcu_stats.grace_period_ns + elapsed);
+        if (elapsed > rcu_stats.grace_period_max_ns) {
+            qatomic_set(&rcu_stats.grace_period_max_ns, elapsed);
+        }
     }
 }
 
@@ -322,6 +343,7 @@ static void *call_rcu_thread(void *opaque)
 
             n--;
             node->func(node);
+            qatomic_set(&rcu_stats.callbacks, rcu_stats.callbacks + 1);
         }
         bql_unlock();
     }
@@ -330,10 +352,33 @@ static void *call_rcu_thread(void *opaque)
 
 void call_rcu1(struct rcu_head *node, void (*func)(struct rcu_head *node))
 {
+    int count, peak;
+
     node->func = func;
     enqueue(node);
-    qatomic_inc(&rcu_call_count);
+    count = qatomic_fetch_inc(&rcu_call_count) + 1;
     qemu_event_set(&rcu_call_ready_event);
+
+    peak = qatomic_read(&rcu_call_count_peak);
+    while (count > peak) {
+        int old = qatomic_cmpxchg(&rcu_call_count_peak, peak, count);
+        if (old == peak) {
+            break;
+        }
+        peak = old;
+    }
+}
+
+void rcu_get_stats(RCUStats *stats)
+{
+    stats->pending = qatomic_read(&rcu_call_count);
+    stats->pending_peak = qatomic_read(&rcu_call_count_peak);
+    stats->callbacks = qatomic_read(&rcu_stats.callbacks);
+    stats->grace_periods = qatomic_read(&rcu_stats.grace_periods);
+    stats->forced_grace_periods =
+        qatomic_read(&rcu_stats.forced_grace_periods);
+    stats->grace_period_ns = qatomic_read(&rcu_stats.grace_period_ns);
+    stats->grace_period_max_ns = qatomic_read(&rcu_stats.grace_period_max_ns);
 }
 
 
@@ -26,6 +26,13 @@
 
 static void do_spawn_thread(ThreadPoolAio *pool);
 
+/*
+ * Requests submitted inside a defer_call_begin()/defer_call_end() section
+ * are handed to the workers in one go, so that pool->lock is taken once per
+ * batch rather than once per request.  Larger batches are split.
+ */
+#define THREAD_POOL_MAX_BATCH 32
+
 typedef struct ThreadPoolElementAio ThreadPoolElementAio;
 
 enum ThreadState {
@@ -51,8 +58,13 @@ struct ThreadPoolElementAio {
     enum ThreadState state;
     int ret;
 
-    /* Access to this list is protected by lock.  */
+    /*
+     * Access to this list is protected by lock, unless deferred is true:
+     * then the request is still on pool->deferred_list, which is only
+     * accessed from the pool's AioContext.
+     */
     QTAILQ_ENTRY(ThreadPoolElementAio) reqs;
+    bool deferred;
 
     /* This list is only written by the thread pool's mother thread.  */
     QLIST_ENTRY(ThreadPoolElementAio) all;
@@ -68,6 +80,8 @@ struct ThreadPoolAio {
 
     /* The following variables are only accessed from one AioContext. */
     QLIST_HEAD(, ThreadPoolElementAio) head;
+    QTAILQ_HEAD(, ThreadPoolElementAio) deferred_list;
+    int n_deferred;
 
     /* The following variables are protected by lock.  */
     QTAILQ_HEAD(, ThreadPoolElementAio) request_list;
@@ -226,7 +240,12 @@ static void thread_pool_cancel(BlockAIOCB *acb)
 
     QEMU_LOCK_GUARD(&pool->lock);
     if (qatomic_read(&elem->state) == THREAD_QUEUED) {
-        QTAILQ_REMOVE(&pool->request_list, elem, reqs);
+        if (elem->deferred) {
+            QTAILQ_REMOVE(&pool->deferred_list, elem, reqs);
+            pool->n_deferred--;
+        } else {
+            QTAILQ_REMOVE(&pool->request_list, elem, reqs);
+        }
         qemu_bh_schedule(pool->completion_bh);
 
         qatomic_set(&elem->ret, -ECANCELED);
@@ -235,6 +254,43 @@ static void thread_pool_cancel(BlockAIOCB *acb)
 
 }
 
+/* Move deferred requests to the request list and wake up the workers. */
+static void thread_pool_submit_deferred(void *opaque)
+{
+    ThreadPoolAio *pool = opaque;
+    ThreadPoolElementAio *req;
+    int n = pool->n_deferred;
+    int wakeups;
+
+    if (n == 0) {
+        return;
+    }
+
+    trace_thread_pool_submit_deferred(pool, n);
+
+    qemu_mutex_lock(&pool->lock);
+    while ((req = QTAILQ_FIRST(&pool->deferred_list))) {
+        QTAILQ_REMOVE(&pool->deferred_list, req, reqs);
+        req->deferred = false;
+        if (pool->idle_threads == 0 && pool->cur_threads < pool->max_threads) {
+            spawn_thread(pool);
+        }
+        QTAILQ_INSERT_TAIL(&pool->request_list, req, reqs);
+    }
+    pool->n_deferred = 0;
+
+    /*
+     * Busy workers pick up the new requests when they are done with their
+     * current one, so only the idle ones need a wakeup.
+     */
+    wakeups = MIN(n, pool->idle_threads);
+    qemu_mutex_unlock(&pool->lock);
+
+    while (wakeups--) {
+        qemu_cond_signal(&pool->request_cond);
+    }
+}
+
 static const AIOCBInfo thread_pool_aiocb_info = {
     .aiocb_size         = sizeof(ThreadPoolElementAio),
     .cancel_async       = thread_pool_cancel,
@@ -260,13 +316,13 @@ BlockAIOCB *thread_pool_submit_aio(ThreadPoolFunc *func, void *arg,
 
     trace_thread_pool_submit_aio(pool, req, arg);
 
-    qemu_mutex_lock(&pool->lock);
-    if (pool->idle_threads == 0 && pool->cur_threads < pool->max_threads) {
-        spawn_thread(pool);
+    req->deferred = true;
+    QTAILQ_INSERT_TAIL(&pool->deferred_list, req, reqs);
+    if (++pool->n_deferred >= THREAD_POOL_MAX_BATCH) {
+        thread_pool_submit_deferred(pool);
+    } else {
+        defer_call(thread_pool_submit_deferred, pool);
     }
-    QTAILQ_INSERT_TAIL(&pool->request_list, req, reqs);
-    qemu_mutex_unlock(&pool->lock);
-    qemu_cond_signal(&pool->request_cond);
     return &req->common;
 }
 
@@ -334,6 +390,7 @@ static void thread_pool_init_one(ThreadPoolAio *pool, AioContext *ctx)
     pool->new_thread_bh = aio_bh_new(ctx, spawn_thread_bh_fn, pool);
 
     QLIST_INIT(&pool->head);
+    QTAILQ_INIT(&pool->deferred_list);
     QTAILQ_INIT(&pool->request_list);
 
     thread_pool_update_params(pool, ctx);
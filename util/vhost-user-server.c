@@ -9,6 +9,7 @@
  */
 #include "qemu/osdep.h"
 #include "qemu/error-report.h"
+#include "qemu/lockable.h"
 #include "qemu/main-loop.h"
 #include "qemu/vhost-user-server.h"
 #include "qemu/aio-wait.h"
@@ -52,6 +53,14 @@
  * possible by QIOChannel's support for spurious coroutine re-entry in
  * qio_channel_yield(). The coroutine will restart I/O when re-entered from the
  * new AioContext.
+ *
+ * If the server was started with a list of virtqueue AioContexts, each
+ * virtqueue's kick fd is monitored in its own AioContext (VuServerVq->ctx)
+ * instead. Kicks of different virtqueues then run in parallel, each under its
+ * VuServerVq->lock. vu_client_trip() takes the locks of all virtqueues while
+ * it handles a message and while it calls vu_deinit(), so that libvhost-user
+ * never sees the device state change under a running virtqueue. Detaching
+ * also takes all locks, which waits for running kick handlers to return.
  */
 
 static void vmsg_close_fds(VhostUserMsg *vmsg)
@@ -91,16 +100,60 @@ static void panic_cb(VuDev *vu_dev, const char *buf)
     error_report("vu_panic: %s", buf);
 }
 
+static void vu_lock_all_vqs(VuServer *server)
+{
+    int i;
+
+    if (!server->vqs) {
+        return;
+    }
+    for (i = 0; i < server->max_queues; i++) {
+        qemu_rec_mutex_lock(&server->vqs[i].lock);
+    }
+}
+
+static void vu_unlock_all_vqs(VuServer *server)
+{
+    int i;
+
+    if (!server->vqs) {
+        return;
+    }
+    for (i = server->max_queues - 1; i >= 0; i--) {
+        qemu_rec_mutex_unlock(&server->vqs[i].lock);
+    }
+}
+
+void vhost_user_server_lock_vq(VuServer *server, VuVirtq *vq)
+{
+    if (server->vqs) {
+        qemu_rec_mutex_lock(&server->vqs[vq - server->vu_dev.vq].lock);
+    }
+}
+
+void vhost_user_server_unlock_vq(VuServer *server, VuVirtq *vq)
+{
+    if (server->vqs) {
+        qemu_rec_mutex_unlock(&server->vqs[vq - server->vu_dev.vq].lock);
+    }
+}
+
 void vhost_user_server_inc_in_flight(VuServer *server)
 {
-    assert(!server->wait_idle);
+    assert(!qatomic_read(&server->wait_idle));
     qatomic_inc(&server->in_flight);
 }
 
 void vhost_user_server_dec_in_flight(VuServer *server)
 {
+    /*
+     * Requests complete in the iothreads of the virtqueues, concurrently with
+     * vu_client_trip() deciding whether to wait for them.  qatomic_fetch_dec()
+     * is a full barrier that pairs with the smp_mb() there, so either we see
+     * wait_idle or vu_client_trip() sees in_flight drop to zero.
+     */
     if (qatomic_fetch_dec(&server->in_flight) == 1) {
-        if (server->wait_idle) {
+        if (qatomic_xchg(&server->wait_idle, false)) {
             aio_co_wake(server->co_trip);
         }
     }
@@ -205,6 +258,12 @@ vu_message_read(VuDev *vu_dev, int conn_fd, VhostUserMsg *vmsg)
         }
     }
 
+    /* Released by vu_client_trip() once vu_dispatch() has handled it */
+    if (server->vqs && !server->msg_locked) {
+        vu_lock_all_vqs(server);
+        server->msg_locked = true;
+    }
+
     return true;
 
 fail:
@@ -219,26 +278,42 @@ static coroutine_fn void vu_client_trip(void *opaque)
     VuDev *vu_dev = &server->vu_dev;
 
     while (!vu_dev->broken) {
+        bool ok;
+
         if (server->quiescing) {
             server->co_trip = NULL;
             aio_wait_kick();
             return;
         }
         /* vu_dispatch() returns false if server->ctx went away */
-        if (!vu_dispatch(vu_dev) && server->ctx) {
+        ok = vu_dispatch(vu_dev);
+
+        if (server->msg_locked) {
+            server->msg_locked = false;
+            vu_unlock_all_vqs(server);
+        }
+        if (!ok && server->ctx) {
             break;
         }
     }
 
-    if (vhost_user_server_has_in_flight(server)) {
-        /* Wait for requests to complete before we can unmap the memory */
-        server->wait_idle = true;
+    /* Wait for requests to complete before we can unmap the memory */
+    qatomic_set(&server->wait_idle, true);
+    smp_mb(); /* pairs with qatomic_fetch_dec() in dec_in_flight */
+    if (vhost_user_server_has_in_flight(server) ||
+        !qatomic_xchg(&server->wait_idle, false)) {
+        /*
+         * Either requests are still in flight, or the last one completed
+         * after we set wait_idle and has already taken over the wakeup.
+         */
         qemu_coroutine_yield();
-        server->wait_idle = false;
     }
+    assert(!qatomic_read(&server->wait_idle));
     assert(!vhost_user_server_has_in_flight(server));
 
+    vu_lock_all_vqs(server);
     vu_deinit(vu_dev);
+    vu_unlock_all_vqs(server);
 
     /* vu_deinit() should have called remove_watch() */
     assert(QTAILQ_EMPTY(&server->vu_fd_watches));
@@ -290,6 +365,67 @@ static VuFdWatch *find_vu_fd_watch(VuServer *server, int fd)
     return NULL;
 }
 
+/* Kick handler for a virtqueue with its own AioContext */
+static void vq_kick_handler(void *opaque)
+{
+    VuServerVq *svq = opaque;
+    VuServer *server = svq->server;
+    VuDev *vu_dev = &server->vu_dev;
+    VuFdWatch *vu_fd_watch;
+    vu_watch_cb cb = NULL;
+    void *pvt = NULL;
+
+    qemu_rec_mutex_lock(&svq->lock);
+
+    /* The server may have been detached while we waited for the lock */
+    if (server->ctx) {
+        int fd = vu_dev->vq[svq->idx].kick_fd;
+
+        WITH_QEMU_LOCK_GUARD(&server->watch_lock) {
+            vu_fd_watch = find_vu_fd_watch(server, fd);
+            if (vu_fd_watch) {
+                cb = vu_fd_watch->cb;
+                pvt = vu_fd_watch->pvt;
+            }
+        }
+    }
+
+    if (cb) {
+        cb(vu_dev, 0, pvt);
+
+        /* Stop vu_client_trip() if an error occurred in the callback */
+        if (vu_dev->broken) {
+            qio_channel_shutdown(server->ioc, QIO_CHANNEL_SHUTDOWN_BOTH, NULL);
+        }
+    }
+
+    qemu_rec_mutex_unlock(&svq->lock);
+}
+
+static void vu_fd_watch_attach(VuServer *server, VuFdWatch *vu_fd_watch)
+{
+    if (server->vqs) {
+        VuServerVq *svq = &server->vqs[(intptr_t)vu_fd_watch->pvt];
+
+        aio_set_fd_handler(svq->ctx, vu_fd_watch->fd, vq_kick_handler,
+                           NULL, NULL, NULL, svq);
+    } else {
+        aio_set_fd_handler(server->ctx, vu_fd_watch->fd, kick_handler,
+                           NULL, NULL, NULL, vu_fd_watch);
+    }
+}
+
+static void vu_fd_watch_detach(VuServer *server, VuFdWatch *vu_fd_watch)
+{
+    AioContext *ctx = server->ctx;
+
+    if (server->vqs) {
+        ctx = server->vqs[(intptr_t)vu_fd_watch->pvt].ctx;
+    }
+    aio_set_fd_handler(ctx, vu_fd_watch->fd, NULL, NULL, NULL, NULL,
+                       vu_fd_watch);
+}
+
 static void
 set_watch(VuDev *vu_dev, int fd, int vu_evt,
           vu_watch_cb cb, void *pvt)
@@ -300,6 +436,8 @@ set_watch(VuDev *vu_dev, int fd, int vu_evt,
     g_assert(fd >= 0);
     g_assert(cb);
 
+    QEMU_LOCK_GUARD(&server->watch_lock);
+
     VuFdWatch *vu_fd_watch = find_vu_fd_watch(server, fd);
 
     if (!vu_fd_watch) {
@@ -311,10 +449,9 @@ set_watch(VuDev *vu_dev, int fd, int vu_evt,
         vu_fd_watch->cb = cb;
         /* TODO: handle error more gracefully than aborting */
         qemu_set_blocking(fd, false, &error_abort);
-        aio_set_fd_handler(server->ctx, fd, kick_handler,
-                           NULL, NULL, NULL, vu_fd_watch);
         vu_fd_watch->vu_dev = vu_dev;
         vu_fd_watch->pvt = pvt;
+        vu_fd_watch_attach(server, vu_fd_watch);
     }
 }
 
@@ -327,12 +464,14 @@ static void remove_watch(VuDev *vu_dev, int fd)
 
     server = container_of(vu_dev, VuServer, vu_dev);
 
+    QEMU_LOCK_GUARD(&server->watch_lock);
+
     VuFdWatch *vu_fd_watch = find_vu_fd_watch(server, fd);
 
     if (!vu_fd_watch) {
         return;
     }
-    aio_set_fd_handler(server->ctx, fd, NULL, NULL, NULL, NULL, NULL);
+    vu_fd_watch_detach(server, vu_fd_watch);
 
     QTAILQ_REMOVE(&server->vu_fd_watches, vu_fd_watch, next);
     g_free(vu_fd_watch);
@@ -396,10 +535,11 @@ void vhost_user_server_stop(VuServer *server)
     if (server->sioc) {
         VuFdWatch *vu_fd_watch;
 
+        vu_lock_all_vqs(server);
         QTAILQ_FOREACH(vu_fd_watch, &server->vu_fd_watches, next) {
-            aio_set_fd_handler(server->ctx, vu_fd_watch->fd,
-                               NULL, NULL, NULL, NULL, vu_fd_watch);
+            vu_fd_watch_detach(server, vu_fd_watch);
         }
+        vu_unlock_all_vqs(server);
 
         qio_channel_shutdown(server->ioc, QIO_CHANNEL_SHUTDOWN_BOTH, NULL);
 
@@ -410,6 +550,17 @@ void vhost_user_server_stop(VuServer *server)
         qio_net_listener_disconnect(server->listener);
         object_unref(OBJECT(server->listener));
     }
+
+    if (server->vqs) {
+        int i;
+
+        for (i = 0; i < server->max_queues; i++) {
+            qemu_rec_mutex_destroy(&server->vqs[i].lock);
+        }
+        g_free(server->vqs);
+        server->vqs = NULL;
+    }
+    qemu_mutex_destroy(&server->watch_lock);
 }
 
 /*
@@ -429,16 +580,18 @@ void vhost_user_server_attach_aio_context(VuServer *server, AioContext *ctx)
 {
     VuFdWatch *vu_fd_watch;
 
+    vu_lock_all_vqs(server);
     server->ctx = ctx;
 
     if (!server->sioc) {
+        vu_unlock_all_vqs(server);
         return;
     }
 
     QTAILQ_FOREACH(vu_fd_watch, &server->vu_fd_watches, next) {
-        aio_set_fd_handler(ctx, vu_fd_watch->fd, kick_handler, NULL,
-                           NULL, NULL, vu_fd_watch);
+        vu_fd_watch_attach(server, vu_fd_watch);
     }
+    vu_unlock_all_vqs(server);
 
     if (server->co_trip) {
         /*
@@ -464,16 +617,17 @@ void vhost_user_server_attach_aio_context(VuServer *server, AioContext *ctx)
 /* Called with server->ctx acquired */
 void vhost_user_server_detach_aio_context(VuServer *server)
 {
+    vu_lock_all_vqs(server);
     if (server->sioc) {
         VuFdWatch *vu_fd_watch;
 
         QTAILQ_FOREACH(vu_fd_watch, &server->vu_fd_watches, next) {
-            aio_set_fd_handler(server->ctx, vu_fd_watch->fd,
-                               NULL, NULL, NULL, NULL, vu_fd_watch);
+            vu_fd_watch_detach(server, vu_fd_watch);
         }
     }
 
     server->ctx = NULL;
+    vu_unlock_all_vqs(server);
 
     if (server->ioc) {
         if (server->in_qio_channel_yield) {
@@ -486,6 +640,8 @@ void vhost_user_server_detach_aio_context(VuServer *server)
 bool vhost_user_server_start(VuServer *server,
                              SocketAddress *socket_addr,
                              AioContext *ctx,
+                             AioContext **vq_ctxs,
+                             size_t n_vq_ctxs,
                              uint16_t max_queues,
                              const VuDevIface *vu_iface,
                              Error **errp)
@@ -517,6 +673,20 @@ bool vhost_user_server_start(VuServer *server,
         .ctx                   = ctx,
     };
 
+    qemu_mutex_init(&server->watch_lock);
+
+    if (n_vq_ctxs) {
+        int i;
+
+        server->vqs = g_new0(VuServerVq, max_queues);
+        for (i = 0; i < max_queues; i++) {
+            server->vqs[i].server = server;
+            server->vqs[i].idx = i;
+            server->vqs[i].ctx = vq_ctxs[i % n_vq_ctxs];
+            qemu_rec_mutex_init(&server->vqs[i].lock);
+        }
+    }
+
     qio_net_listener_set_name(server->listener, "vhost-user-backend-listener");
 
     qio_net_listener_set_client_func(server->listener,